@@ -0,0 +1,305 @@
+#include "container.h"
+
+#include <stdexcept>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+
+namespace graph_constraint_solver {
+
+    namespace impl {
+        // output_stream.cpp
+        std::runtime_error errno_error(const std::string &prefix);
+
+        void append_field(std::string &bytes, unsigned long long value) {
+            for (size_t i = 0; i < container::kFieldWidth; ++i) {
+                bytes.push_back(static_cast<char>(value >> (8 * i) & 0xff));
+            }
+        }
+
+        unsigned long long read_field(const char *bytes) {
+            unsigned long long value = 0;
+            for (size_t i = 0; i < container::kFieldWidth; ++i) {
+                value |= static_cast<unsigned long long>(static_cast<unsigned char>(bytes[i])) << (8 * i);
+            }
+            return value;
+        }
+
+        void pread_fully(int fd, char *data, size_t length, unsigned long long offset, const std::string &error_prefix) {
+            while (length) {
+                auto read = ::pread(fd, data, length, offset);
+                if (read < 0 && errno == EINTR) continue;
+                if (read <= 0) {
+                    throw std::runtime_error(error_prefix + "unexpected end of file");
+                }
+                data += read;
+                length -= read;
+                offset += read;
+            }
+        }
+
+        void pwrite_fully(int fd, const char *data, size_t length, unsigned long long offset, const std::string &error_prefix) {
+            while (length) {
+                auto written = ::pwrite(fd, data, length, offset);
+                if (written < 0 && errno == EINTR) continue;
+                if (written < 0) {
+                    throw std::runtime_error(error_prefix + "write failed: " + std::strerror(errno));
+                }
+                data += written;
+                length -= written;
+                offset += written;
+            }
+        }
+
+        // walks the entries from the beginning of the file, returns the offset after the last complete one
+        unsigned long long scan_container(int fd, unsigned long long file_size, std::vector<container::Entry> &index,
+                const std::string &error_prefix) {
+
+            index.clear();
+            unsigned long long offset = container::kMagicSize;
+            char header[container::kEntryHeaderSize];
+            while (offset + container::kEntryHeaderSize <= file_size) {
+                pread_fully(fd, header, container::kEntryHeaderSize, offset, error_prefix);
+                auto length = read_field(header);
+                auto data_offset = offset + container::kEntryHeaderSize;
+                if (length == container::kIncomplete || length > file_size - data_offset) {
+                    break;
+                }
+                index.push_back(container::Entry{data_offset, length, static_cast<long long>(read_field(header + container::kFieldWidth))});
+                offset = data_offset + length;
+            }
+            return offset;
+        }
+
+        // the footer is trusted only if it describes the entries that are actually in the file:
+        // an entry started after it was written has replaced the start of its index with an incomplete entry,
+        // and the footer of an entry that was not closed yet points past an incomplete entry
+        bool read_container_footer(int fd, unsigned long long file_size, std::vector<container::Entry> &index,
+                unsigned long long &index_offset, const std::string &error_prefix) {
+
+            if (file_size < container::kMagicSize + container::kFooterSize) {
+                return false;
+            }
+            char footer[container::kFooterSize];
+            pread_fully(fd, footer, container::kFooterSize, file_size - container::kFooterSize, error_prefix);
+            if (std::memcmp(footer + 2 * container::kFieldWidth, container::kFooterMagic, container::kMagicSize) != 0) {
+                return false;
+            }
+            index_offset = read_field(footer);
+            auto count = read_field(footer + container::kFieldWidth);
+            auto index_size = file_size - container::kFooterSize;
+            if (index_offset < container::kMagicSize || index_offset > index_size ||
+                    count != (index_size - index_offset) / container::kRecordSize ||
+                    (index_size - index_offset) % container::kRecordSize != 0) {
+                return false;
+            }
+            char first_field[container::kFieldWidth];
+            pread_fully(fd, first_field, container::kFieldWidth, index_offset, error_prefix);
+            if (read_field(first_field) == container::kIncomplete) {
+                return false;
+            }
+
+            std::string records(count * container::kRecordSize, '\0');
+            pread_fully(fd, records.data(), records.size(), index_offset, error_prefix);
+            index.resize(count);
+            for (size_t i = 0; i < count; ++i) {
+                auto record = records.data() + i * container::kRecordSize;
+                index[i].offset = read_field(record);
+                index[i].length = read_field(record + container::kFieldWidth);
+                index[i].seed = static_cast<long long>(read_field(record + 2 * container::kFieldWidth));
+                if (index[i].offset < container::kMagicSize + container::kEntryHeaderSize ||
+                        index[i].length > index_offset - index[i].offset) {
+                    return false;
+                }
+            }
+            if (count) {
+                auto &last = index.back();
+                char header[container::kEntryHeaderSize];
+                pread_fully(fd, header, container::kEntryHeaderSize, last.offset - container::kEntryHeaderSize, error_prefix);
+                if (last.offset + last.length != index_offset || read_field(header) != last.length ||
+                        static_cast<long long>(read_field(header + container::kFieldWidth)) != last.seed) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        // index of a non-empty container file, returns the offset a new entry starts at
+        unsigned long long read_container_index(int fd, const std::string &filepath, std::vector<container::Entry> &index,
+                const std::string &error_prefix) {
+
+            struct stat file_stat{};
+            if (fstat(fd, &file_stat) != 0) {
+                throw std::runtime_error(error_prefix + "can't stat " + filepath);
+            }
+            unsigned long long file_size = file_stat.st_size;
+            char magic[container::kMagicSize];
+            if (file_size < container::kMagicSize) {
+                throw std::runtime_error(error_prefix + filepath + " is not a container file");
+            }
+            pread_fully(fd, magic, container::kMagicSize, 0, error_prefix);
+            if (std::memcmp(magic, container::kHeaderMagic, container::kMagicSize) != 0) {
+                throw std::runtime_error(error_prefix + filepath + " is not a container file");
+            }
+
+            unsigned long long index_offset;
+            if (read_container_footer(fd, file_size, index, index_offset, error_prefix)) {
+                return index_offset;
+            }
+            return scan_container(fd, file_size, index, error_prefix);
+        }
+    } //impl
+
+    // ContainerOutputStream
+
+    ContainerOutputStream::ContainerOutputStream(const std::string &filepath, long long seed)
+        : fd_(-1), seed_(seed), entry_offset_(0), entry_length_(0) {
+
+        fd_ = ::open(filepath.c_str(), O_RDWR | O_CREAT, 0644);
+        if (fd_ == -1) {
+            throw impl::errno_error("Can't open file " + filepath);
+        }
+        try {
+            // concurrent generator runs appending to the same pack take turns
+            while (flock(fd_, LOCK_EX) != 0) {
+                if (errno != EINTR) {
+                    throw impl::errno_error("ContainerOutputStream error: can't lock " + filepath);
+                }
+            }
+            struct stat file_stat{};
+            if (fstat(fd_, &file_stat) != 0) {
+                throw impl::errno_error("ContainerOutputStream error: can't stat " + filepath);
+            }
+            if (file_stat.st_size == 0) {
+                impl::pwrite_fully(fd_, container::kHeaderMagic, container::kMagicSize, 0, "ContainerOutputStream error: ");
+                entry_offset_ = container::kMagicSize;
+            }
+            else {
+                entry_offset_ = impl::read_container_index(fd_, filepath, index_, "ContainerOutputStream error: ");
+            }
+            // from here until close() the pack is read by walking the entries up to this one
+            std::string header;
+            impl::append_field(header, container::kIncomplete);
+            impl::append_field(header, static_cast<unsigned long long>(seed_));
+            impl::pwrite_fully(fd_, header.data(), header.size(), entry_offset_, "ContainerOutputStream error: ");
+            output_ = std::make_unique<FileOutputStream>(fd_, entry_offset_ + container::kEntryHeaderSize);
+        }
+        catch (...) {
+            ::close(fd_);
+            throw;
+        }
+    }
+
+    ContainerOutputStream::~ContainerOutputStream() {
+        // an entry that was not closed stays incomplete, readers and the next writer stop before it
+        output_.reset();
+        close_file();
+    }
+
+    void ContainerOutputStream::close_file() {
+        if (fd_ != -1) {
+            ::close(fd_);
+            fd_ = -1;
+        }
+    }
+
+    void ContainerOutputStream::write(const char *data, size_t length) {
+        entry_length_ += length;
+        output_->write(data, length);
+    }
+
+    void ContainerOutputStream::reserve(size_t length) {
+        output_->reserve(length);
+    }
+
+    void ContainerOutputStream::close() {
+        output_->close();
+        auto data_offset = entry_offset_ + container::kEntryHeaderSize;
+        index_.push_back(container::Entry{data_offset, entry_length_, seed_});
+
+        std::string tail;
+        tail.reserve(index_.size() * container::kRecordSize + container::kFooterSize);
+        for (auto &entry : index_) {
+            impl::append_field(tail, entry.offset);
+            impl::append_field(tail, entry.length);
+            impl::append_field(tail, static_cast<unsigned long long>(entry.seed));
+        }
+        auto index_offset = data_offset + entry_length_;
+        impl::append_field(tail, index_offset);
+        impl::append_field(tail, index_.size());
+        tail.append(container::kFooterMagic, container::kMagicSize);
+
+        impl::pwrite_fully(fd_, tail.data(), tail.size(), index_offset, "ContainerOutputStream error: ");
+        if (ftruncate(fd_, index_offset + tail.size()) != 0) {
+            throw impl::errno_error("ContainerOutputStream error: ftruncate failed");
+        }
+        // the entry counts only once its length is in place, the new footer is checked against it
+        std::string length;
+        impl::append_field(length, entry_length_);
+        impl::pwrite_fully(fd_, length.data(), length.size(), entry_offset_, "ContainerOutputStream error: ");
+        auto fd = fd_;
+        fd_ = -1;
+        if (::close(fd) != 0) {
+            throw impl::errno_error("ContainerOutputStream error: close failed");
+        }
+    }
+
+    // ContainerReader
+
+    ContainerReader::ContainerReader(const std::string &filepath) : filepath_(filepath), fd_(-1) {
+        fd_ = ::open(filepath.c_str(), O_RDONLY);
+        if (fd_ == -1) {
+            throw impl::errno_error("Can't open file " + filepath);
+        }
+        try {
+            impl::read_container_index(fd_, filepath, index_, "ContainerReader error: ");
+        }
+        catch (...) {
+            ::close(fd_);
+            throw;
+        }
+    }
+
+    ContainerReader::~ContainerReader() {
+        ::close(fd_);
+    }
+
+    size_t ContainerReader::size() {
+        return index_.size();
+    }
+
+    const container::Entry& ContainerReader::entry(size_t index) {
+        if (index >= index_.size()) {
+            throw std::invalid_argument("ContainerReader error: entry " + std::to_string(index) + " out of range, " +
+                    filepath_ + " has " + std::to_string(index_.size()) + " entries");
+        }
+        return index_[index];
+    }
+
+    std::string ContainerReader::read(size_t index) {
+        auto &selected = entry(index);
+        std::string data(selected.length, '\0');
+        read_fully(data.data(), data.size(), selected.offset);
+        return data;
+    }
+
+    void ContainerReader::extract(size_t index, std::ostream &output) {
+        auto &selected = entry(index);
+        std::vector<char> buffer(std::min<unsigned long long>(selected.length, FileOutputStream::kBufferSize));
+        for (unsigned long long done = 0; done < selected.length; ) {
+            auto part = std::min<unsigned long long>(selected.length - done, buffer.size());
+            read_fully(buffer.data(), part, selected.offset + done);
+            output.write(buffer.data(), part);
+            done += part;
+        }
+    }
+
+    void ContainerReader::read_fully(char *data, size_t length, unsigned long long offset) {
+        impl::pread_fully(fd_, data, length, offset, "ContainerReader error: ");
+    }
+}
@@ -0,0 +1,87 @@
+#ifndef GRAPH_CONSTRAINT_SOLVER_CONTAINER_H
+#define GRAPH_CONSTRAINT_SOLVER_CONTAINER_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "output_stream.h"
+
+namespace graph_constraint_solver {
+
+    // many outputs packed into one file, so a test pack doesn't pay for a file creation per test
+    // layout (all numbers are little-endian 64-bit):
+    //   "GCSPACK1", entries one after another, index, footer
+    //   entry: length, seed, 'length' bytes of data; the length is kIncomplete until the entry is closed
+    //   index: 'count' records (offset, length, seed), offsets of the data from the beginning of the file
+    //   footer: index offset, count, "GCSINDEX"
+    // new entries overwrite the old index and footer, writers lock the whole file for the time of an entry;
+    // a pack without a valid footer, e.g. after a writer was killed, is read by walking the entries,
+    // and the walk stops at the first incomplete one
+    namespace container {
+        static const size_t kMagicSize = 8;
+        static const char kHeaderMagic[kMagicSize + 1] = "GCSPACK1";
+        static const char kFooterMagic[kMagicSize + 1] = "GCSINDEX";
+        static const size_t kFieldWidth = 8;
+        static const size_t kRecordSize = 3 * kFieldWidth;
+        static const size_t kFooterSize = 2 * kFieldWidth + kMagicSize;
+        static const size_t kEntryHeaderSize = 2 * kFieldWidth;
+        static const unsigned long long kIncomplete = ~0ULL;
+
+        struct Entry {
+            unsigned long long offset;
+            unsigned long long length;
+            long long seed;
+        };
+    }
+
+    // appends one entry to a container file, creating the file if it doesn't exist
+    // the entry is written through a FileOutputStream, the index is rewritten on close()
+    class ContainerOutputStream : public OutputStream {
+    public:
+        ContainerOutputStream(const std::string &filepath, long long seed);
+        ~ContainerOutputStream() override;
+        void write(const char *data, size_t length) override;
+        void reserve(size_t length) override;
+        void close() override;
+
+    private:
+        // closing the descriptor releases the lock
+        void close_file();
+
+        int fd_;
+        long long seed_;
+        std::vector<container::Entry> index_;
+        unsigned long long entry_offset_;
+        unsigned long long entry_length_;
+        std::unique_ptr<FileOutputStream> output_;
+    };
+
+    class ContainerReader {
+    public:
+        // throws std::runtime_error if the file is not a container
+        explicit ContainerReader(const std::string &filepath);
+        ~ContainerReader();
+        ContainerReader(const ContainerReader&) = delete;
+        ContainerReader& operator=(const ContainerReader&) = delete;
+
+        size_t size();
+        const container::Entry& entry(size_t index);
+        std::string read(size_t index);
+        // copies the entry to 'output' without holding it in memory
+        void extract(size_t index, std::ostream &output);
+
+    private:
+        void read_fully(char *data, size_t length, unsigned long long offset);
+
+        std::string filepath_;
+        int fd_;
+        std::vector<container::Entry> index_;
+    };
+}
+
+#ifdef GRAPH_CONSTRAINT_SOLVER_SINGLE_HEADER
+#include "container.cpp"
+#endif
+
+#endif //GRAPH_CONSTRAINT_SOLVER_CONTAINER_H
@@ -0,0 +1,51 @@
+#include "edge_sink.h"
+
+namespace graph_constraint_solver {
+
+    // EdgeSink
+
+    void EdgeSink::end() {
+
+    }
+
+    void EdgeSink::set_shift(Graph::OrderType shift) {
+        shift_ = shift;
+    }
+
+    void EdgeSink::add_edge(Graph::OrderType from, Graph::OrderType to) {
+        consume_edge(from + shift_, to + shift_);
+    }
+
+    // GraphBuilderSink
+
+    void GraphBuilderSink::begin(Graph::Type type, Graph::OrderType order, Graph::SizeType) {
+        graph_ = Graph::create(order, type);
+    }
+
+    GraphPtr GraphBuilderSink::graph() {
+        return graph_;
+    }
+
+    void GraphBuilderSink::consume_edge(Graph::OrderType from, Graph::OrderType to) {
+        graph_->add_edge(from, to);
+    }
+
+    // CountingSink
+
+    void CountingSink::begin(Graph::Type, Graph::OrderType order, Graph::SizeType) {
+        order_ = order;
+        size_ = 0;
+    }
+
+    Graph::OrderType CountingSink::order() {
+        return order_;
+    }
+
+    Graph::SizeType CountingSink::size() {
+        return size_;
+    }
+
+    void CountingSink::consume_edge(Graph::OrderType, Graph::OrderType) {
+        ++size_;
+    }
+}
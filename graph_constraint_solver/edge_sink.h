@@ -0,0 +1,59 @@
+#ifndef GRAPH_CONSTRAINT_SOLVER_EDGE_SINK_H
+#define GRAPH_CONSTRAINT_SOLVER_EDGE_SINK_H
+
+#include "graph.h"
+
+namespace graph_constraint_solver {
+
+    // receiver of generated edges, lets generators emit a graph without materializing it
+    class EdgeSink {
+    public:
+        virtual ~EdgeSink() = default;
+
+        // called once before any edge, 'order' and 'size' are the totals of everything added before end()
+        virtual void begin(Graph::Type type, Graph::OrderType order, Graph::SizeType size) = 0;
+        virtual void end();
+
+        // 'shift' is added to both ends of every following edge (used to place components one after another)
+        void set_shift(Graph::OrderType shift);
+        void add_edge(Graph::OrderType from, Graph::OrderType to);
+
+    protected:
+        virtual void consume_edge(Graph::OrderType from, Graph::OrderType to) = 0;
+
+    private:
+        Graph::OrderType shift_ = 0;
+    };
+
+    class GraphBuilderSink : public EdgeSink {
+    public:
+        void begin(Graph::Type type, Graph::OrderType order, Graph::SizeType size) override;
+        GraphPtr graph();
+
+    protected:
+        void consume_edge(Graph::OrderType from, Graph::OrderType to) override;
+
+    private:
+        GraphPtr graph_;
+    };
+
+    class CountingSink : public EdgeSink {
+    public:
+        void begin(Graph::Type type, Graph::OrderType order, Graph::SizeType size) override;
+        Graph::OrderType order();
+        Graph::SizeType size();
+
+    protected:
+        void consume_edge(Graph::OrderType from, Graph::OrderType to) override;
+
+    private:
+        Graph::OrderType order_ = 0;
+        Graph::SizeType size_ = 0;
+    };
+}
+
+#ifdef GRAPH_CONSTRAINT_SOLVER_SINGLE_HEADER
+#include "edge_sink.cpp"
+#endif
+
+#endif //GRAPH_CONSTRAINT_SOLVER_EDGE_SINK_H
@@ -11,6 +11,177 @@
 
 namespace graph_constraint_solver {
 
+    namespace impl {
+        // two-edge-connected components are 2-vertex-connected subcomponents glued in cut points
+        const Graph::OrderType kMinimumSubcomponentOrder = 3;
+
+        bool two_edge_connected_order_bounds(Graph::OrderType cut_points, Constraint::OrderBounds component_order_bounds,
+                Constraint::OrderBounds &order_bounds) {
+            auto min_component_order = kMinimumSubcomponentOrder * (cut_points + 1) - cut_points;
+            order_bounds.first = std::max(component_order_bounds.first, min_component_order);
+            order_bounds.second = component_order_bounds.second;
+            return order_bounds.first <= order_bounds.second;
+        }
+
+        Constraint::SizeBounds two_edge_connected_size_bounds(Graph::OrderType cut_points, Graph::OrderType order) {
+            auto max_subcomponent_order = order + cut_points - kMinimumSubcomponentOrder * cut_points;
+            Graph::SizeType left_bound = std::max(order, (cut_points + 1) * kMinimumSubcomponentOrder);
+            Graph::SizeType right_bound = cut_points * kMinimumSubcomponentOrder +
+                    Utils::complete_graph_size(max_subcomponent_order);
+            return Constraint::SizeBounds(left_bound, right_bound);
+        }
+
+        enum FeasibilityAnalysis {
+            kTwoEdgeConnectedAnalysis,
+            kConnectedAnalysis,
+        };
+    }
+
+    std::map<Generator::FeasibilityKey, Generator::FeasibleValues> Generator::feasibility_cache_;
+    std::mutex Generator::feasibility_cache_mutex_;
+
+    void Generator::FeasibleValues::add(Graph::SizeType value) {
+        if (!intervals.empty() && intervals.back().second + 1 == value) {
+            intervals.back().second = value;
+        }
+        else {
+            intervals.emplace_back(value, value);
+        }
+        status = Feasibility::kFeasible;
+    }
+
+    Graph::SizeType Generator::FeasibleValues::count() const {
+        Graph::SizeType result = 0;
+        for (auto &interval : intervals) {
+            result += interval.second - interval.first + 1;
+        }
+        return result;
+    }
+
+    Graph::SizeType Generator::FeasibleValues::at(Graph::SizeType index) const {
+        for (auto &interval : intervals) {
+            auto length = interval.second - interval.first + 1;
+            if (index < length) {
+                return interval.first + index;
+            }
+            index -= length;
+        }
+        throw std::out_of_range("FeasibleValues error: index out of range");
+    }
+
+    Generator::FeasibleValues Generator::memoized_feasibility(const FeasibilityKey &key,
+            const std::function<FeasibleValues()> &analyze) {
+        {
+            std::lock_guard<std::mutex> lock(feasibility_cache_mutex_);
+            auto it = feasibility_cache_.find(key);
+            if (it != feasibility_cache_.end()) {
+                return it->second;
+            }
+        }
+        // analyses may look up other analyses, so the lock is not held while computing
+        auto result = analyze();
+        std::lock_guard<std::mutex> lock(feasibility_cache_mutex_);
+        return feasibility_cache_.emplace(key, result).first->second;
+    }
+
+    Generator::FeasibleValues Generator::two_edge_connected_feasibility(Constraint::OrderBounds order_bounds,
+            Constraint::SizeBounds size_bounds, Constraint::OrderBounds cut_point_bounds) {
+
+        FeasibilityKey key(impl::kTwoEdgeConnectedAnalysis, order_bounds.first, order_bounds.second,
+                size_bounds.first, size_bounds.second, cut_point_bounds.first, cut_point_bounds.second, 0, 0);
+        return memoized_feasibility(key, [&]() {
+            FeasibleValues result;
+            for (auto cut_points = cut_point_bounds.first; cut_points <= cut_point_bounds.second; ++cut_points) {
+                Constraint::OrderBounds cut_points_order_bounds;
+                if (!impl::two_edge_connected_order_bounds(cut_points, order_bounds, cut_points_order_bounds)) {
+                    continue;
+                }
+                Constraint::SizeBounds cut_points_size_bounds(
+                        impl::two_edge_connected_size_bounds(cut_points, cut_points_order_bounds.first).first,
+                        impl::two_edge_connected_size_bounds(cut_points, cut_points_order_bounds.second).second);
+                if (!Utils::invalid_segment(cut_points_size_bounds) &&
+                        Utils::non_empty_segments_intersection(cut_points_size_bounds, size_bounds)) {
+                    result.add(cut_points);
+                }
+            }
+            return result;
+        });
+    }
+
+    Generator::FeasibleValues Generator::connected_feasibility(Constraint::OrderBounds order_bounds,
+            Constraint::SizeBounds size_bounds, Constraint::OrderBounds cut_point_bounds,
+            Constraint::SizeBounds bridge_bounds) {
+
+        FeasibilityKey key(impl::kConnectedAnalysis, order_bounds.first, order_bounds.second,
+                size_bounds.first, size_bounds.second, cut_point_bounds.first, cut_point_bounds.second,
+                bridge_bounds.first, bridge_bounds.second);
+        return memoized_feasibility(key, [&]() {
+            FeasibleValues result;
+            if (Utils::invalid_segment(cut_point_bounds) || Utils::invalid_segment(bridge_bounds)) {
+                return result;
+            }
+
+            // without bridges the component is two-edge-connected
+            if (bridge_bounds.first == 0 &&
+                    two_edge_connected_feasibility(order_bounds, size_bounds, cut_point_bounds).status ==
+                    Feasibility::kFeasible) {
+                result.add(0);
+            }
+
+            auto loop_left_bound = std::max<Graph::SizeType>(1, bridge_bounds.first);
+            for (Graph::SizeType bridges = loop_left_bound; bridges <= bridge_bounds.second; ++bridges) {
+
+                // first we need to generate some tree with 'bridges' edges
+                // right_bound of 'initial_cut_point_bounds' is a maximum number of inner vertices we allowed to have in a tree
+                auto initial_cut_point_bounds = Constraint::OrderBounds(
+                        std::min<Graph::SizeType>(bridges - 1, 1),
+                        std::min<Graph::SizeType>(bridges - 1, cut_point_bounds.second));
+
+                Graph::OrderType initial_order = bridges + 1;
+                Graph::SizeType initial_size = bridges;
+
+                if (initial_cut_point_bounds.second == 0) {
+                    if (bridges == 1 && Utils::in_range(order_bounds, 2) && Utils::in_range(size_bounds, 1)) {
+                        result.add(1);
+                    }
+                    continue;
+                }
+
+                // now we need to check whether we can or not ...
+                Graph::OrderType need_order = std::max(0, order_bounds.first - initial_order);
+                Graph::SizeType need_size = std::max<Graph::SizeType>(0, size_bounds.first - initial_size);
+
+                Graph::OrderType can_order = order_bounds.second - initial_order;
+                Graph::SizeType can_size = size_bounds.second - initial_size;
+
+                auto current_order_to_size_bounds = Constraint::SizeBounds(need_order, Utils::complete_graph_size(can_order));
+                auto current_size_bounds = Constraint::SizeBounds(need_size, can_size);
+
+                // REMEMBER: for undirected graphs 'order' steps from 1 to 3 (can't go from 1 to 2)
+
+                if (!Utils::non_empty_segments_intersection(current_order_to_size_bounds, current_size_bounds)) {
+                    continue;
+                }
+
+                Graph::OrderType need_cut_point = cut_point_bounds.first;
+                if (need_cut_point <= initial_cut_point_bounds.second) {
+                    result.add(bridges);
+                }
+                else {
+                    // TODO: check 'second formulae' too
+                    // it works for tighter cases, while this formulae does not
+                    Graph::SizeType to_add = 2 * (need_cut_point - bridges + 1);
+                    if (to_add > can_order || to_add > can_size) {
+                        continue;
+                    }
+                    // TODO: check whether it's possible to satisfy SizeConstraints
+                    result.add(bridges);
+                }
+            }
+            return result;
+        });
+    }
+
     // TODO: rename
     GraphComponentsPtr Generator::generate(ConstraintBlockPtr constraint_block_ptr) {
         auto graph_components = generate_block(constraint_block_ptr);
@@ -33,6 +204,46 @@ namespace graph_constraint_solver {
 //        return result;
 //    }
 
+    GraphComponentsPtr Generator::generate_many(ConstraintBlockPtr constraint_block_ptr, size_t count) {
+        // the override is consumed by the block's own draw, blocks generated inside it draw their own numbers
+        component_number_override_ = count;
+        GraphComponentsPtr components;
+        try {
+            components = generate_block(constraint_block_ptr);
+        }
+        catch (...) {
+            component_number_override_ = -1;
+            throw;
+        }
+        auto consumed = component_number_override_ == -1;
+        component_number_override_ = -1;
+        if (!consumed || components->components().size() != count) {
+            throw std::runtime_error("generate_many error: " + constraint_block_ptr->component_type_name() +
+                    " block generated " + std::to_string(components->components().size()) + " components instead of " +
+                    std::to_string(count));
+        }
+
+        auto vertices_block = constraint_block_ptr->vertices_block();
+        auto edges_block = constraint_block_ptr->edges_block();
+        if (!vertices_block && !edges_block) {
+            return components;
+        }
+        auto result = std::make_shared<GraphComponents>();
+        for (auto &component : components->components()) {
+            result->add_component(replace_with_components(component, vertices_block, edges_block));
+        }
+        return result;
+    }
+
+    Graph::OrderType Generator::draw_component_number(Constraint::OrderBounds component_number_bounds) {
+        if (component_number_override_ != -1) {
+            auto component_number = static_cast<Graph::OrderType>(component_number_override_);
+            component_number_override_ = -1;
+            return component_number;
+        }
+        return random.next(component_number_bounds);
+    }
+
     GraphComponentsPtr Generator::generate_block(ConstraintBlockPtr constraint_block_ptr) {
         if (constraint_block_ptr->component_type() == ConstraintBlock::ComponentType::kTwoConnected) {
             return generate_two_connected_block(std::static_pointer_cast<TwoConnectedConstraintBlock>(constraint_block_ptr));
@@ -52,18 +263,24 @@ namespace graph_constraint_solver {
     }
 
     GraphComponentsPtr Generator::generate_strongly_connected_block(std::shared_ptr<StronglyConnectedConstraintBlock> constraint_block_ptr) {
+        auto plan = plan_strongly_connected_block(constraint_block_ptr);
+        return build_components(plan);
+    }
+
+    Generator::BlockPlan Generator::plan_strongly_connected_block(std::shared_ptr<StronglyConnectedConstraintBlock> constraint_block_ptr) {
         auto graph_type = constraint_block_ptr->get_graph_type();
         auto component_number_bounds = constraint_block_ptr->template get_constraint<ComponentNumberConstraint>()->bounds();
         auto component_order_bounds = constraint_block_ptr->template get_constraint<ComponentOrderConstraint>()->bounds();
         auto component_size_bounds = constraint_block_ptr->template get_constraint<ComponentSizeConstraint>()->bounds();
 
-        auto component_number = random.next(component_number_bounds);
-        auto components = std::make_shared<GraphComponents>();
+        auto component_number = draw_component_number(component_number_bounds);
+        auto feasible_orders = two_connected_order_bounds(Graph::Type::kDirected, component_order_bounds,
+                component_size_bounds);
+        BlockPlan plan;
         for (Graph::OrderType i = 0; i < component_number; ++i) {
-            auto component = generate_strongly_connected_component(component_order_bounds, component_size_bounds);
-            components->add_component(component);
+            plan.push_back(plan_strongly_connected_component(feasible_orders, component_size_bounds));
         }
-        return components;
+        return plan;
     }
 
     GraphComponentsPtr Generator::generate_connected_block(std::shared_ptr<ConnectedConstraintBlock> constraint_block_ptr) {
@@ -78,78 +295,9 @@ namespace graph_constraint_solver {
         component_bridge_bounds.second = std::min(component_bridge_bounds.second, component_size_bounds.second);
         component_bridge_bounds.second = std::min<Graph::SizeType>(component_bridge_bounds.second, component_order_bounds.second - 1);
 
-        if (Utils::invalid_segment(component_cut_point_bounds) || Utils::invalid_segment(component_bridge_bounds)) {
-            throw std::runtime_error("generate_connected_component error: given constraints cannot be satisfied");
-        }
-
-        std::vector<Graph::SizeType> suitable_number_of_bridges;
-        if (component_bridge_bounds.first == 0) {
-            auto two_edge_connected_block_ptr = constraint_block_ptr->template clone<TwoEdgeConnectedConstraintBlock>();
-            auto component_number_constraint = two_edge_connected_block_ptr->template get_constraint<ComponentNumberConstraint>();
-            component_number_constraint->set_bounds(1, 1);
-            try {
-                if (generate_two_edge_connected_block(two_edge_connected_block_ptr, true)) {
-                    suitable_number_of_bridges.push_back(0);
-                }
-            }
-            catch (...) {}
-        }
-
-        auto loop_left_bound = std::max<Graph::SizeType>(1, component_bridge_bounds.first);
-        for (Graph::SizeType bridges = loop_left_bound; bridges <= component_bridge_bounds.second; ++bridges) {
-
-            // first we need to generate some tree with 'bridges' edges
-            // right_bound of 'initial_cut_point_bounds' is a maximum number of inner vertices we allowed to have in a tree
-            auto initial_cut_point_bounds = Constraint::OrderBounds(
-                    std::min<Graph::SizeType>(bridges - 1, 1),
-                    std::min<Graph::SizeType>(bridges - 1, component_cut_point_bounds.second));
-
-            Graph::OrderType initial_order = bridges + 1;
-            Graph::SizeType initial_size = bridges;
-
-            if (initial_cut_point_bounds.second == 0) {
-                if (bridges == 1 && Utils::in_range(component_order_bounds, 2) &&
-                        Utils::in_range(component_size_bounds, 1)) {
-                    suitable_number_of_bridges.push_back(1);
-                }
-                continue;
-            }
-
-            // now we need to check whether we can or not ...
-            Graph::OrderType need_order = std::max(0, component_order_bounds.first - initial_order);
-            Graph::SizeType need_size = std::max<Graph::SizeType>(0, component_size_bounds.first - initial_size);
-
-            Graph::OrderType can_order = component_order_bounds.second - initial_order;
-            Graph::SizeType can_size = component_size_bounds.second - initial_size;
-
-            auto current_order_bounds = Constraint::OrderBounds(need_order, can_order);
-            auto current_order_to_size_bounds = Constraint::SizeBounds(need_order, Utils::complete_graph_size(can_order));
-            auto current_size_bounds = Constraint::SizeBounds(need_size, can_size);
-
-            // REMEMBER: for undirected graphs 'order' steps from 1 to 3 (can't go from 1 to 2)
-
-            if (!Utils::non_empty_segments_intersection(current_order_to_size_bounds, current_size_bounds)) {
-                continue;
-            }
-
-            Graph::OrderType need_cut_point = component_cut_point_bounds.first;
-            if (need_cut_point <= initial_cut_point_bounds.second) {
-                suitable_number_of_bridges.push_back(bridges);
-            }
-            else {
-                // TODO: check 'second formulae' too
-                // it works for tighter cases, while this formulae does not
-                Graph::SizeType to_add = 2 * (need_cut_point - bridges + 1);
-                if (to_add > can_order || to_add > can_size) {
-                    continue;
-                }
-                // TODO: check whether it's possible to satisfy SizeConstraints
-//                if ()
-                suitable_number_of_bridges.push_back(bridges);
-            }
-        }
-
-        if (suitable_number_of_bridges.empty()) {
+        auto feasible_bridges = connected_feasibility(component_order_bounds, component_size_bounds,
+                component_cut_point_bounds, component_bridge_bounds);
+        if (feasible_bridges.status != Feasibility::kFeasible) {
             throw std::runtime_error("generate_connected_component error: given constraints cannot be satisfied");
         }
 
@@ -173,31 +321,127 @@ namespace graph_constraint_solver {
                     component_cut_point_bounds, bridges);
         };
 
-        auto component_number = random.next(component_number_bounds);
+        // choices are drawn first, the components are then generated in parallel, each from its own stream
+        auto component_number = draw_component_number(component_number_bounds);
+        std::vector<std::pair<Graph::SizeType, Random::StreamId>> component_bridges_and_stream(component_number);
+        for (auto &[bridges, stream_id] : component_bridges_and_stream) {
+            bridges = feasible_bridges.at(random.next(feasible_bridges.count()));
+            stream_id = random.split();
+        }
+        std::vector<GraphPtr> graphs(component_number);
+        Utils::parallel_for(component_number, [&](size_t index) {
+            auto stream = random.stream(component_bridges_and_stream[index].second);
+            graphs[index] = generate_component(component_bridges_and_stream[index].first);
+        });
         auto components = std::make_shared<GraphComponents>();
-        for (Graph::OrderType i = 0; i < component_number; ++i) {
-            auto bridges = suitable_number_of_bridges.at(random.next(suitable_number_of_bridges.size()));
-            components->add_component(generate_component(bridges));
+        for (auto &graph : graphs) {
+            components->add_component(graph);
         }
         return components;
     }
 
     GraphComponentsPtr Generator::generate_two_connected_block(std::shared_ptr<TwoConnectedConstraintBlock> constraint_block_ptr) {
+        auto plan = plan_two_connected_block(constraint_block_ptr);
+        return build_components(plan);
+    }
+
+    Generator::BlockPlan Generator::plan_two_connected_block(std::shared_ptr<TwoConnectedConstraintBlock> constraint_block_ptr) {
         // TODO: default values
         auto graph_type = constraint_block_ptr->get_graph_type();
         auto component_number_bounds = constraint_block_ptr->template get_constraint<ComponentNumberConstraint>()->bounds();
         auto component_order_bounds = constraint_block_ptr->template get_constraint<ComponentOrderConstraint>()->bounds();
         auto component_size_bounds = constraint_block_ptr->template get_constraint<ComponentSizeConstraint>()->bounds();
 
-        auto component_number = random.next(component_number_bounds);
-        auto components = std::make_shared<GraphComponents>();
+        auto component_number = draw_component_number(component_number_bounds);
+        auto feasible_orders = two_connected_order_bounds(graph_type, component_order_bounds, component_size_bounds);
+        BlockPlan plan;
         for (Graph::OrderType i = 0; i < component_number; ++i) {
-            auto component = generate_two_connected_component(graph_type, component_order_bounds, component_size_bounds);
-            components->add_component(component);
+            plan.push_back(plan_two_connected_component(graph_type, feasible_orders, component_size_bounds));
+        }
+        return plan;
+    }
+
+    Generator::ComponentPlan::ComponentPlan(Graph::Type graph_type, Graph::OrderType order, Graph::SizeType size,
+            Emitter emit)
+        : graph_type(graph_type), order(order), size(size), emit(emit), stream(random.split()) {
+
+    }
+
+    void Generator::emit_component(ComponentPlan &plan, EdgeSink &sink) {
+        auto stream = random.stream(plan.stream);
+        plan.emit(sink);
+    }
+
+    GraphPtr Generator::build_component(ComponentPlan &plan) {
+        GraphBuilderSink builder;
+        builder.begin(plan.graph_type, plan.order, plan.size);
+        emit_component(plan, builder);
+        builder.end();
+        return builder.graph();
+    }
+
+    GraphComponentsPtr Generator::build_components(BlockPlan &plan) {
+        std::vector<GraphPtr> graphs(plan.size());
+        Utils::parallel_for(plan.size(), [&](size_t index) {
+            graphs[index] = build_component(plan[index]);
+        });
+        auto components = std::make_shared<GraphComponents>();
+        for (auto &graph : graphs) {
+            components->add_component(graph);
         }
         return components;
     }
 
+    bool Generator::supports_streaming(ConstraintBlockPtr constraint_block_ptr) {
+        if (constraint_block_ptr->vertices_block() || constraint_block_ptr->edges_block()) {
+            return false;
+        }
+        auto component_type = constraint_block_ptr->component_type();
+        return component_type == ConstraintBlock::ComponentType::kTree ||
+               component_type == ConstraintBlock::ComponentType::kTwoConnected ||
+               component_type == ConstraintBlock::ComponentType::kStronglyConnected;
+    }
+
+    Generator::BlockPlan Generator::plan_block(ConstraintBlockPtr constraint_block_ptr) {
+        if (constraint_block_ptr->component_type() == ConstraintBlock::ComponentType::kTwoConnected) {
+            return plan_two_connected_block(std::static_pointer_cast<TwoConnectedConstraintBlock>(constraint_block_ptr));
+        }
+        if (constraint_block_ptr->component_type() == ConstraintBlock::ComponentType::kStronglyConnected) {
+            return plan_strongly_connected_block(std::static_pointer_cast<StronglyConnectedConstraintBlock>(constraint_block_ptr));
+        }
+        if (constraint_block_ptr->component_type() == ConstraintBlock::ComponentType::kTree) {
+            return plan_tree_block(std::static_pointer_cast<TreeConstraintBlock>(constraint_block_ptr));
+        }
+        throw std::runtime_error("Generator error: " + constraint_block_ptr->component_type_name() +
+        "-block cannot be planned in advance");
+    }
+
+    void Generator::generate_to_sink(ConstraintBlockPtr constraint_block_ptr, EdgeSink &sink) {
+        if (!supports_streaming(constraint_block_ptr)) {
+            throw std::runtime_error("Generator error: " + constraint_block_ptr->component_type_name() +
+            "-block cannot be streamed");
+        }
+
+        auto plan = plan_block(constraint_block_ptr);
+        Graph::OrderType total_order = 0;
+        Graph::SizeType total_size = 0;
+        for (auto &component_plan : plan) {
+            total_order += component_plan.order;
+            total_size += component_plan.size;
+        }
+
+        auto graph_type = plan.empty() ? Graph::Type::kUndirected : plan.front().graph_type;
+        sink.begin(graph_type, total_order, total_size);
+        Graph::OrderType shift = 0;
+        for (auto &component_plan : plan) {
+            sink.set_shift(shift);
+            emit_component(component_plan, sink);
+            shift += component_plan.order;
+        }
+        sink.set_shift(0);
+        sink.end();
+    }
+
     // TODO: remove this?
     ConstrainedGraphPtr Generator::go_with_the_winners(GraphGenerator initial_graph_generator, GoNext go_next, bool to_print,
             int colony_size, int growth_rate, int outer_iterations, int inner_iterations) {
@@ -262,40 +506,59 @@ namespace graph_constraint_solver {
         return std::make_shared<ConstrainedGraph>();
     }
 
-    GraphPtr Generator::generate_strongly_connected_component(Constraint::OrderBounds order_bounds,
+    Constraint::SizeBounds Generator::two_connected_size_bounds(Graph::Type graph_type, Graph::OrderType order,
             Constraint::SizeBounds size_bounds) {
 
-        auto get_size_bounds = [&](Graph::OrderType order) {
-            Constraint::SizeBounds order_to_size_bounds, res;
-            order_to_size_bounds.first = order;
-            order_to_size_bounds.second = static_cast<Graph::SizeType>(order) * (order - 1);
-            if (Utils::non_empty_segments_intersection(order_to_size_bounds, size_bounds)) {
-                res = Utils::segments_intersection(order_to_size_bounds, size_bounds);
+        Constraint::SizeBounds order_to_size_bounds;
+        order_to_size_bounds.first = order;
+        order_to_size_bounds.second = Utils::complete_graph_size(order) * (graph_type == Graph::Type::kDirected ? 2 : 1);
+        if (Utils::invalid_segment(order_to_size_bounds) ||
+                !Utils::non_empty_segments_intersection(order_to_size_bounds, size_bounds)) {
+            return Constraint::SizeBounds(-1, -1);
+        }
+        return Utils::segments_intersection(order_to_size_bounds, size_bounds);
+    }
+
+    Constraint::OrderBounds Generator::two_connected_order_bounds(Graph::Type graph_type,
+            Constraint::OrderBounds order_bounds, Constraint::SizeBounds size_bounds) {
+
+        auto maximum_size = [&](Graph::SizeType order) {
+            return Utils::complete_graph_size(order) * (graph_type == Graph::Type::kDirected ? 2 : 1);
+        };
+        // the smallest cycle, smaller orders can't have 'order' edges
+        Graph::OrderType left = std::max<Graph::OrderType>(order_bounds.first,
+                graph_type == Graph::Type::kDirected ? 2 : 3);
+        auto right = static_cast<Graph::OrderType>(std::min<Graph::SizeType>(order_bounds.second, size_bounds.second));
+        if (left > right || maximum_size(right) < size_bounds.first) {
+            return Constraint::OrderBounds(-1, -1);
+        }
+        // the first order whose complete graph is big enough
+        auto high = right;
+        while (left < high) {
+            auto middle = left + (high - left) / 2;
+            if (maximum_size(middle) >= size_bounds.first) {
+                high = middle;
             }
             else {
-                res = Constraint::SizeBounds(-1, -1);
-            }
-            return res;
-        };
-
-        std::vector<Graph::OrderType> suitable_order;
-        for (auto order = order_bounds.first; order <= order_bounds.second; ++order) {
-            auto current_size_bounds = get_size_bounds(order);
-            if (current_size_bounds.first != -1) {
-                suitable_order.push_back(order);
+                left = middle + 1;
             }
         }
+        return Constraint::OrderBounds(left, right);
+    }
+
+    Generator::ComponentPlan Generator::plan_strongly_connected_component(Constraint::OrderBounds feasible_orders,
+            Constraint::SizeBounds size_bounds) {
 
-        if (suitable_order.empty()) {
+        if (feasible_orders.first == -1) {
             throw std::runtime_error("generate_strongly_connected_component error: given constraints cannot be satisfied");
         }
 
-        auto order = suitable_order.at(random.next(suitable_order.size()));
-        auto size = random.next(get_size_bounds(order));
-        return generate_two_connected_component(Graph::Type::kDirected, order, size, 2, 0.2);
+        auto order = random.next(feasible_orders);
+        auto size = random.next(two_connected_size_bounds(Graph::Type::kDirected, order, size_bounds));
+        return plan_two_connected_component(Graph::Type::kDirected, order, size, 2, 0.2);
     }
 
-    GraphPtr Generator::generate_tree(Graph::Type graph_type, Constraint::OrderBounds order_bounds,
+    Generator::ComponentPlan Generator::plan_tree(Constraint::OrderBounds order_bounds,
             Constraint::OrderBounds diameter_bounds, Graph::OrderType max_vertex_degree) {
 
         // TODO: use TreeBroadness coefficient
@@ -313,6 +576,16 @@ namespace graph_constraint_solver {
             throw std::runtime_error("Tree generator error: given constraints cannot be satisfied");
         };
 
+        // every tree of every allowed order satisfies the diameter and degree limits,
+        // so any labeled tree will do and no diameter has to be picked
+        if (diameter_bounds.first <= std::min<Graph::OrderType>(order_bounds.first - 1, 2) &&
+                diameter_bounds.second >= order_bounds.second - 1 && max_vertex_degree >= order_bounds.second - 1) {
+            auto order = random.next(order_bounds);
+            return ComponentPlan(Graph::Type::kUndirected, order, order - 1, [this, order](EdgeSink &sink) {
+                generate_tree_uniform(sink, order);
+            });
+        }
+
         if (diameter_bounds.first >= order_bounds.second) {
             bad();
         }
@@ -325,11 +598,12 @@ namespace graph_constraint_solver {
 
         // give this guy a graph...
         if (max_vertex_degree <= 1) {
-            auto graph = std::make_shared<UndirectedGraph>(max_vertex_degree + 1);
-            if (max_vertex_degree == 1) {
-                graph->add_edge(0, 1);
-            }
-            return graph;
+            return ComponentPlan(Graph::Type::kUndirected, max_vertex_degree + 1, max_vertex_degree,
+                    [max_vertex_degree](EdgeSink &sink) {
+                if (max_vertex_degree == 1) {
+                    sink.add_edge(0, 1);
+                }
+            });
         }
 
 //        diameter_bounds.first = std::max(diameter_bounds.first, 2);
@@ -397,22 +671,29 @@ namespace graph_constraint_solver {
         order_bounds.second = std::min<Graph::OrderType>(order_bounds.second, maximum_vertices_number(diameter));
         auto order = random.next(order_bounds);
 
-        auto tree = generate_tree_fixed_diameter(graph_type, order, diameter, max_vertex_degree);
-        return tree;
+        return ComponentPlan(Graph::Type::kUndirected, order, order - 1,
+                [this, order, diameter, max_vertex_degree](EdgeSink &sink) {
+            generate_tree_fixed_diameter(sink, order, diameter, max_vertex_degree);
+        });
     }
 
-    GraphPtr Generator::generate_tree_fixed_diameter(Graph::Type graph_type, Graph::OrderType order,
+    void Generator::generate_tree_fixed_diameter(EdgeSink &sink, Graph::OrderType order,
             Graph::OrderType diameter, Graph::OrderType max_vertex_degree) {
 
 //        std::cout << diameter << std::endl;
-        GraphPtr g = std::make_shared<UndirectedGraph>(order);
         if (order == 1) {
-            return g;
+            return;
         }
 
-        std::vector<Graph::OrderType> level(order);
+        std::vector<Graph::OrderType> level(order), degree(order);
+        auto add_edge = [&](Graph::OrderType from, Graph::OrderType to) {
+            sink.add_edge(from, to);
+            ++degree[from];
+            ++degree[to];
+        };
+
         for (Graph::OrderType i = 0; i < diameter; ++i) {
-            g->add_edge(i, i + 1);
+            add_edge(i, i + 1);
             level[i] = std::min(i, diameter - i);
         }
 
@@ -435,8 +716,9 @@ namespace graph_constraint_solver {
         };
 
 //        Graph::OrderType made = diameter;
+        Random::Batch batch(random);
         for (auto i = diameter + 1; i < order; ++i) {
-            auto v = random.next(i);
+            Graph::OrderType v = batch.next(i);
             v = dsu.get_parent(v);
 //            auto seg = dsu.get_segment(v);
 //            // segment can become too big, in this case it will eat more and more
@@ -445,10 +727,10 @@ namespace graph_constraint_solver {
 //
 //            }
 
-            g->add_edge(v, i);
+            add_edge(v, i);
             level[i] = level[v] - 1;
             // vertex 'v' is full, connect segment to the left or right
-            if (g->adjacency_list()[v].size() == max_vertex_degree) {
+            if (degree[v] == max_vertex_degree) {
                 connect_to_neighbor(v);
             }
             // vertex 'i' is on it's last level, connect it
@@ -456,7 +738,51 @@ namespace graph_constraint_solver {
                 connect_to_neighbor(i);
             }
         }
-        return g;
+    }
+
+    void Generator::generate_tree_uniform(EdgeSink &sink, Graph::OrderType order) {
+        if (order <= 1) {
+            return;
+        }
+
+        // chunks get their streams in order, so the sequence doesn't depend on the number of threads
+        size_t length = order - 2;
+        size_t chunks = (length + kPruferChunkSize - 1) / kPruferChunkSize;
+        std::vector<Random::StreamId> chunk_stream(chunks);
+        for (auto &stream_id : chunk_stream) {
+            stream_id = random.split();
+        }
+        std::vector<unsigned long long> sequence(length);
+        Utils::parallel_for(chunks, [&](size_t chunk) {
+            auto stream = random.stream(chunk_stream[chunk]);
+            auto begin = chunk * kPruferChunkSize;
+            random.fill(sequence.data() + begin, std::min<size_t>(kPruferChunkSize, length - begin), order);
+        });
+
+        std::vector<Graph::OrderType> degree(order, 1);
+        for (auto v : sequence) {
+            ++degree[v];
+        }
+        // 'next_leaf' only moves forward: a vertex below it that becomes a leaf is used right away
+        Graph::OrderType next_leaf = 0;
+        while (degree[next_leaf] != 1) {
+            ++next_leaf;
+        }
+        auto leaf = next_leaf;
+        for (auto v : sequence) {
+            Graph::OrderType to = v;
+            sink.add_edge(leaf, to);
+            if (--degree[to] == 1 && to < next_leaf) {
+                leaf = to;
+            }
+            else {
+                do {
+                    ++next_leaf;
+                } while (degree[next_leaf] != 1);
+                leaf = next_leaf;
+            }
+        }
+        sink.add_edge(leaf, order - 1);
     }
 
     GraphPtr Generator::generate_tree_fixed_leaves_number(Graph::OrderType order, Graph::OrderType leaves_number,
@@ -505,15 +831,16 @@ namespace graph_constraint_solver {
             }
         };
 
+        Random::Batch batch(random);
         for (Graph::OrderType i = 0; i < order - 1; ++i) {
-            bool its_merge_time = random.next() < merge_probability;
+            bool its_merge_time = batch.next() < merge_probability;
             // last iteration must be 'merge'
             if (merges_cnt == 1 && i != order - 2) {
                 its_merge_time = false;
             }
             if (its_merge_time && merges_cnt && !confirmed_branches.empty() || !go_up_cnt) {
                 --merges_cnt;
-                auto branch_idx = confirmed_branches.at(random.next(confirmed_branches.size()));
+                auto branch_idx = confirmed_branches.at(batch.next(confirmed_branches.size()));
                 branch_idx = branch_dsu.get_parent(branch_idx);
                 auto neighbor = pick_neighbor(branch_idx);
                 graph->add_edge(branch_head[branch_idx], branch_head[neighbor]);
@@ -521,7 +848,7 @@ namespace graph_constraint_solver {
             }
             else {
                 --go_up_cnt;
-                auto branch_idx = branch_dsu.get_parent(random.next(leaves_number));
+                auto branch_idx = branch_dsu.get_parent(batch.next(leaves_number));
                 graph->add_edge(branch_head[branch_idx], next_free_vertex);
                 if (branch_head[branch_idx] == branch_idx) {
                     confirmed_branches.push_back(branch_idx);
@@ -535,6 +862,11 @@ namespace graph_constraint_solver {
     }
 
     GraphComponentsPtr Generator::generate_tree_block(std::shared_ptr<TreeConstraintBlock> constraint_block_ptr) {
+        auto plan = plan_tree_block(constraint_block_ptr);
+        return build_components(plan);
+    }
+
+    Generator::BlockPlan Generator::plan_tree_block(std::shared_ptr<TreeConstraintBlock> constraint_block_ptr) {
         auto graph_type = constraint_block_ptr->get_graph_type();
 //        auto order_bounds = block_ptr->get_order_bounds();
         auto component_number_bounds = constraint_block_ptr->template get_constraint<ComponentNumberConstraint>()->bounds();
@@ -552,59 +884,56 @@ namespace graph_constraint_solver {
 //            return Utils::non_empty_segments_intersection(glob_left, glob_right, comp_left, comp_right);
 //        };
 
-        auto components = std::make_shared<GraphComponents>();
-        auto component_number = random.next(component_number_bounds);
+        BlockPlan plan;
+        auto component_number = draw_component_number(component_number_bounds);
 
         for (Graph::OrderType i = 0; i < component_number; ++i) {
-            components->add_component(generate_tree(graph_type, component_order_bounds, component_diameter_bounds,
-                    component_max_vertex_degree));
+            plan.push_back(plan_tree(component_order_bounds, component_diameter_bounds, component_max_vertex_degree));
         }
 
-        return components;
+        return plan;
     }
 
-    // TODO: this is copy-paste from generate_strongly_connected_component
-    GraphPtr Generator::generate_two_connected_component(Graph::Type graph_type,
-            Constraint::OrderBounds order_bounds, Constraint::SizeBounds size_bounds) {
+    Generator::ComponentPlan Generator::plan_two_connected_component(Graph::Type graph_type,
+            Constraint::OrderBounds feasible_orders, Constraint::SizeBounds size_bounds) {
 
-        auto get_size_bounds = [&](Graph::OrderType order) {
-            Constraint::SizeBounds order_to_size_bounds, res;
-            order_to_size_bounds.first = order;
-            order_to_size_bounds.second = Utils::complete_graph_size(order);
-            if (graph_type == Graph::Type::kDirected) {
-                order_to_size_bounds.second *= 2;
-            }
-            if (Utils::non_empty_segments_intersection(order_to_size_bounds, size_bounds)) {
-                res = Utils::segments_intersection(order_to_size_bounds, size_bounds);
-            }
-            else {
-                res = Constraint::SizeBounds(-1, -1);
-            }
-            return res;
-        };
-
-        std::vector<Graph::OrderType> suitable_order;
-        for (auto order = order_bounds.first; order <= order_bounds.second; ++order) {
-            auto current_size_bounds = get_size_bounds(order);
-            if (current_size_bounds.first != -1) {
-                suitable_order.push_back(order);
-            }
-        }
-
-        if (suitable_order.empty()) {
+        if (feasible_orders.first == -1) {
             throw std::runtime_error("generate_two_connected_component error: given constraints cannot be satisfied");
         }
 
-        auto order = suitable_order.at(random.next(suitable_order.size()));
-        auto size = random.next(get_size_bounds(order));
-        return generate_two_connected_component(graph_type, order, size, 3);
+        auto order = random.next(feasible_orders);
+        auto size = random.next(two_connected_size_bounds(graph_type, order, size_bounds));
+        return plan_two_connected_component(graph_type, order, size, 3);
     }
 
     GraphPtr Generator::generate_two_connected_component(Graph::Type graph_type, Graph::OrderType order,
             Graph::SizeType size, Graph::OrderType min_loop_size, double loop_ear_probability) {
 
-        if (order < min_loop_size || !Utils::in_range(order, size, Utils::complete_graph_size(order))) {
-            return std::make_shared<UndirectedGraph>();
+        auto plan = plan_two_connected_component(graph_type, order, size, min_loop_size, loop_ear_probability);
+        return build_component(plan);
+    }
+
+    Generator::ComponentPlan Generator::plan_two_connected_component(Graph::Type graph_type, Graph::OrderType order,
+            Graph::SizeType size, Graph::OrderType min_loop_size, double loop_ear_probability) {
+
+        auto max_size = Utils::complete_graph_size(order) * (graph_type == Graph::Type::kDirected ? 2 : 1);
+        if (order < min_loop_size || !Utils::in_range(order, size, max_size)) {
+            return ComponentPlan(Graph::Type::kUndirected, 0, 0, [](EdgeSink &) {});
+        }
+        return ComponentPlan(graph_type, order, size,
+                [this, graph_type, order, size, min_loop_size, loop_ear_probability](EdgeSink &sink) {
+            generate_two_connected_component(sink, graph_type, order, size, min_loop_size, loop_ear_probability);
+        });
+    }
+
+    // edges are emitted as soon as they are chosen, the only O(size) memory left is the set of used edges
+    void Generator::generate_two_connected_component(EdgeSink &sink, Graph::Type graph_type, Graph::OrderType order,
+            Graph::SizeType size, Graph::OrderType min_loop_size, double loop_ear_probability) {
+
+        auto max_size = Utils::complete_graph_size(order) * (graph_type == Graph::Type::kDirected ? 2 : 1);
+        if (size >= kDenseTwoConnectedDensity * max_size) {
+            generate_dense_two_connected_component(sink, graph_type, order, size);
+            return;
         }
 
         struct edge_hash {
@@ -618,13 +947,15 @@ namespace graph_constraint_solver {
         // maybe we'll use Graph to store the edges ...
         // do not allow parallel edges
         std::unordered_set<Graph::EdgeType, edge_hash> used_edges;
-        std::vector<Graph::EdgeType> result;
+        auto add_edge = [&](Graph::OrderType from, Graph::OrderType to) {
+            sink.add_edge(from, to);
+            used_edges.insert(Graph::EdgeType(from, to));
+        };
 
         auto circuit_rank = size - order + 1;
         auto a1 = circuit_rank == 1 ? order : random.next(min_loop_size, order);
         for (Graph::OrderType i = 0; i < a1; ++i) {
-            result.emplace_back(i, (i + 1) % a1);
-            used_edges.insert(Graph::EdgeType(i, (i + 1) % a1));
+            add_edge(i, (i + 1) % a1);
         }
 
         int vertices_made = a1;
@@ -637,12 +968,14 @@ namespace graph_constraint_solver {
             return used_edges.count(Graph::EdgeType(from, to)) || used_edges.count(Graph::EdgeType(to, from));
         };
 
+        Random::Batch batch(random);
         auto generate_ear = [&](Graph::OrderType n) {
             Graph::OrderType start, finish;
             do {
-                start = random.next(0, vertices_made - 1);
-                finish = random.next(0, vertices_made - 1);
-                if (random.next() < loop_ear_probability) {
+                start = batch.next(0, vertices_made - 1);
+                finish = batch.next(0, vertices_made - 1);
+                // a loop ear without inner vertices would be a self-loop
+                if (n > 0 && batch.next() < loop_ear_probability) {
                     finish = start;
                 }
                 else if (start == finish) {
@@ -651,105 +984,98 @@ namespace graph_constraint_solver {
             } while (n == 0 && edge_exists(start, finish));
 
             if (n == 0) {
-                result.emplace_back(start, finish);
-                used_edges.insert({start, finish});
+                add_edge(start, finish);
             }
             else {
-                result.emplace_back(start, vertices_made++);
-                used_edges.insert({start, vertices_made - 1});
+                add_edge(start, vertices_made++);
 
                 for (int i = 0; i < n - 1; ++i, ++vertices_made) {
-                    result.emplace_back(vertices_made - 1, vertices_made);
-                    used_edges.insert({vertices_made - 1, vertices_made});
+                    add_edge(vertices_made - 1, vertices_made);
                 }
 
-                result.emplace_back(vertices_made - 1, finish);
-                used_edges.insert({vertices_made - 1, finish});
+                add_edge(vertices_made - 1, finish);
             }
         };
 
         for (; ears_made < circuit_rank - 1; ++ears_made) {
-            auto left_bound = Utils::complete_graph_size(vertices_made) == used_edges.size();
-            auto ear_inner_size = random.next(left_bound, order - vertices_made);
+            auto max_made_size = Utils::complete_graph_size(vertices_made) * (graph_type == Graph::Type::kDirected ? 2 : 1);
+            auto left_bound = max_made_size == used_edges.size();
+            auto ear_inner_size = batch.next(left_bound, order - vertices_made);
             generate_ear(ear_inner_size);
         }
         // this condition will be false when we have only 1 ear
         if (ears_made < circuit_rank) {
             generate_ear(order - vertices_made);
         }
-
-        auto graph = Graph::create(order, graph_type);
-        graph->add_edges(result);
-        return graph;
     }
 
-    GraphComponentsPtr Generator::generate_two_edge_connected_block(std::shared_ptr<TwoEdgeConnectedConstraintBlock> constraint_block_ptr,
-            bool check_satisfiability_only) {
-
-        auto graph_type = constraint_block_ptr->get_graph_type();
-        auto component_number_bounds = constraint_block_ptr->template get_constraint<ComponentNumberConstraint>()->bounds();
-        auto component_order_bounds = constraint_block_ptr->template get_constraint<ComponentOrderConstraint>()->bounds();
-        auto component_size_bounds = constraint_block_ptr->template get_constraint<ComponentSizeConstraint>()->bounds();
-        auto component_cut_point_bounds = constraint_block_ptr->template get_constraint<ComponentCutPointConstraint>()->bounds();
-
-        Graph::OrderType min_subcomponent_order = 3;
+    void Generator::generate_dense_two_connected_component(EdgeSink &sink, Graph::Type graph_type,
+            Graph::OrderType order, Graph::SizeType size) {
 
-        auto get_order_bounds = [&](Graph::OrderType cut_points, Constraint::OrderBounds &order_bounds) {
-            auto min_component_order = min_subcomponent_order * (cut_points + 1) - cut_points;
-            order_bounds.first = std::max(component_order_bounds.first, min_component_order);
-            order_bounds.second = component_order_bounds.second;
-            return order_bounds.first <= order_bounds.second;
-        };
-
-        auto get_size_bounds_fixed_order = [&](Graph::OrderType cut_points, Graph::OrderType order) {
-            auto max_subcomponent_order = order + cut_points - min_subcomponent_order * cut_points;
-            Graph::SizeType left_bound = std::max(order, (cut_points + 1) * min_subcomponent_order);
-            Graph::SizeType right_bound = cut_points * min_subcomponent_order + Utils::complete_graph_size(max_subcomponent_order);
-            return Constraint::SizeBounds(left_bound, right_bound);
-        };
-
-        auto get_size_bounds_range_order = [&](Graph::OrderType cut_points, Constraint::OrderBounds order_bounds,
-                Constraint::SizeBounds &size_bounds) {
-            size_bounds.first = get_size_bounds_fixed_order(cut_points, order_bounds.first).first;
-            size_bounds.second = get_size_bounds_fixed_order(cut_points, order_bounds.second).second;
-            if (size_bounds.first > size_bounds.second) {
-                throw std::runtime_error("debug component size bounds");
+        auto directed = graph_type == Graph::Type::kDirected;
+        for (Graph::OrderType i = 0; i < order; ++i) {
+            sink.add_edge(i, (i + 1) % order);
+        }
+        auto cycle_edge = [&](Graph::OrderType from, Graph::OrderType to) {
+            if (to == (from + 1) % order) {
+                return true;
             }
-            return Utils::non_empty_segments_intersection(size_bounds, component_size_bounds);
+            return !directed && from == (to + 1) % order;
         };
 
-        std::vector<Graph::OrderType> suitable_number_of_cut_points;
-        for (auto cut_points = component_cut_point_bounds.first; cut_points <= component_cut_point_bounds.second; ++cut_points) {
-            Constraint::OrderBounds order_bounds;
-            if (!get_order_bounds(cut_points, order_bounds)) {
-                continue;
-            }
-            Constraint::SizeBounds size_bounds;
-            if (get_size_bounds_range_order(cut_points, order_bounds, size_bounds)) {
-                suitable_number_of_cut_points.push_back(cut_points);
+        // selection sampling (Knuth's algorithm S) over the pairs outside the cycle in index order:
+        // every pair is taken with probability needed / remaining, so there are no rejected draws
+        // and every set of chords is equally likely
+        auto max_size = Utils::complete_graph_size(order) * (directed ? 2 : 1);
+        Graph::SizeType needed = size - order;
+        Graph::SizeType remaining = max_size - order;
+        Random::Batch batch(random);
+        for (Graph::OrderType from = 0; from < order && needed; ++from) {
+            for (Graph::OrderType to = directed ? 0 : from + 1; to < order && needed; ++to) {
+                if (to == from || cycle_edge(from, to)) {
+                    continue;
+                }
+                if (batch.next(remaining) < needed) {
+                    sink.add_edge(from, to);
+                    --needed;
+                }
+                --remaining;
             }
         }
+    }
 
-        if (suitable_number_of_cut_points.empty()) {
-            throw std::runtime_error("generate_two_edge_connected_component error: given constraints cannot be satisfied");
-        }
+    GraphComponentsPtr Generator::generate_two_edge_connected_block(std::shared_ptr<TwoEdgeConnectedConstraintBlock> constraint_block_ptr) {
+        auto graph_type = constraint_block_ptr->get_graph_type();
+        auto component_number_bounds = constraint_block_ptr->template get_constraint<ComponentNumberConstraint>()->bounds();
+        auto component_order_bounds = constraint_block_ptr->template get_constraint<ComponentOrderConstraint>()->bounds();
+        auto component_size_bounds = constraint_block_ptr->template get_constraint<ComponentSizeConstraint>()->bounds();
+        auto component_cut_point_bounds = constraint_block_ptr->template get_constraint<ComponentCutPointConstraint>()->bounds();
 
-        if (check_satisfiability_only) {
-            return nullptr;
+        auto feasible_cut_points = two_edge_connected_feasibility(component_order_bounds, component_size_bounds,
+                component_cut_point_bounds);
+        if (feasible_cut_points.status != Feasibility::kFeasible) {
+            throw std::runtime_error("generate_two_edge_connected_component error: given constraints cannot be satisfied");
         }
 
-        auto component_number = random.next(component_number_bounds);
-        GraphComponentsPtr components = std::make_shared<GraphComponents>();
+        struct ComponentChoice {
+            Graph::OrderType order;
+            Constraint::SizeBounds size_bounds;
+            Graph::OrderType cut_points;
+            Random::StreamId stream_id;
+        };
 
+        // choices are drawn first, the components are then generated in parallel, each from its own stream
+        auto component_number = draw_component_number(component_number_bounds);
+        std::vector<ComponentChoice> choices;
         for (Graph::OrderType i = 0; i < component_number; ++i) {
-            auto cut_points = suitable_number_of_cut_points.at(random.next(suitable_number_of_cut_points.size()));
+            Graph::OrderType cut_points = feasible_cut_points.at(random.next(feasible_cut_points.count()));
             Constraint::OrderBounds order_bounds;
-            get_order_bounds(cut_points, order_bounds);
+            impl::two_edge_connected_order_bounds(cut_points, component_order_bounds, order_bounds);
             auto L = order_bounds.first - 1;
             auto R = order_bounds.second;
             while (R - L > 1) {
                 auto mid = (L + R) / 2;
-                auto size_bounds = get_size_bounds_fixed_order(cut_points, mid);
+                auto size_bounds = impl::two_edge_connected_size_bounds(cut_points, mid);
                 if (Utils::non_empty_segments_intersection(size_bounds, component_size_bounds)) {
                     R = mid;
                 }
@@ -761,13 +1087,23 @@ namespace graph_constraint_solver {
             // ok now order_bounds contains only good orders, pick random from it
             auto order = random.next(order_bounds);
 
-            Constraint::SizeBounds size_bounds;
-            get_size_bounds_range_order(cut_points, std::make_pair(order, order), size_bounds);
-            size_bounds = Utils::segments_intersection(size_bounds, component_size_bounds);
+            auto size_bounds = Utils::segments_intersection(impl::two_edge_connected_size_bounds(cut_points, order),
+                    component_size_bounds);
 //            int size = random.next(size_bounds);
 
-            auto component = generate_two_edge_connected_component(graph_type, order, size_bounds, cut_points);
-            components->add_component(component);
+            choices.push_back(ComponentChoice{order, size_bounds, cut_points, random.split()});
+        }
+
+        std::vector<GraphPtr> graphs(component_number);
+        Utils::parallel_for(component_number, [&](size_t index) {
+            auto &choice = choices[index];
+            auto stream = random.stream(choice.stream_id);
+            graphs[index] = generate_two_edge_connected_component(graph_type, choice.order, choice.size_bounds,
+                    choice.cut_points);
+        });
+        GraphComponentsPtr components = std::make_shared<GraphComponents>();
+        for (auto &graph : graphs) {
+            components->add_component(graph);
         }
         return components;
     }
@@ -923,19 +1259,20 @@ namespace graph_constraint_solver {
 //        auto additional_cut_point = can_order / 2 + bridges - 1 - need_cut_point;
         additional_cut_point = random.next(additional_cut_point);
 
+        Random::Batch batch(random);
         for (Graph::OrderType i = 0; i < need_cut_point + additional_cut_point; ++i) {
-            auto index = random.next(tree->order());
+            auto index = batch.next(tree->order());
             auto to_add = 0;
             if (subcomponent_order[index] == 1) {
                 to_add = 2;
-                if (tree->vertex_degree(index) >= 3 && i + 1 < need_cut_point && random.next() < prefer_bridge_cut_points) {
+                if (tree->vertex_degree(index) >= 3 && i + 1 < need_cut_point && batch.next() < prefer_bridge_cut_points) {
                     subcomponent_bridge_cut_points[index]++;
                     ++i;
                 }
                 subcomponent_bridge_cut_points[index]++;
             }
             else {
-                if (subcomponent_order[index] < tree->vertex_degree(index) && random.next() < prefer_bridge_cut_points) {
+                if (subcomponent_order[index] < tree->vertex_degree(index) && batch.next() < prefer_bridge_cut_points) {
                     to_add = 1;
                     subcomponent_bridge_cut_points[index]++;
                 }
@@ -953,13 +1290,13 @@ namespace graph_constraint_solver {
         need_size -= size_used;
         can_size -= size_used;
         can_cut_point -= need_cut_point - additional_cut_point;
-        auto additional_order = random.next(order_bounds.second - order_bounds.first);
+        auto additional_order = batch.next(order_bounds.second - order_bounds.first);
         order_used = size_used = 0;
 
         for (Graph::OrderType i = 0; i < need_order + additional_order; ++i) {
             // in case we pick leaf in a tree we'll increase 'cut_points' by 1
             auto left_bound = (can_cut_point ? 0 : leaves);
-            auto index = random.next(left_bound, tree->order() - 1);
+            auto index = batch.next(left_bound, tree->order() - 1);
             auto to_add = 1;
             if (tree->vertex_degree(index) == 1) {
                 can_cut_point--;
@@ -1050,71 +1387,71 @@ namespace graph_constraint_solver {
             ConstraintBlockPtr edge_block) {
 
         if (!vertex_block && !edge_block) return graph;
-        Graph::OrderType order_sum = 0;
+        auto &skeleton_list = graph->adjacency_list();
         std::vector<GraphPtr> vertex_components(graph->order());
-        for (size_t i = 0; i < graph->order(); ++i) {
-            auto cur = vertex_block ? generate(vertex_block)->components().at(0) : Graph::create(1, graph->type());
-            vertex_components[i] = cur;
-            order_sum += cur->order();
-        }
-
-        std::vector<std::vector<GraphPtr>> edge_components(graph->order());
-        for (size_t i = 0; i < graph->order(); ++i) {
-            edge_components[i].resize(graph->adjacency_list().at(i).size());
-            for (size_t j = 0; j < graph->adjacency_list().at(i).size(); ++j) {
-                // TODO: check if edge_block is nullptr
-                edge_components[i][j] = generate(edge_block)->components().at(0);
-                order_sum += edge_components[i][j]->order();
+        if (vertex_block) {
+            vertex_components = generate_many(vertex_block, graph->order())->components();
+        }
+        else {
+            for (auto &component : vertex_components) {
+                component = Graph::create(1, graph->type());
             }
         }
 
-        GraphPtr result = Graph::create(order_sum, graph->type());
-        std::vector<char> used(graph->order());
-        size_t shift = 0;
-        std::vector<size_t> vertex_components_shift(graph->order());
-
-        for (size_t i = 0; i < graph->order(); ++i) {
-            if (!used[i]) {
-                replace_with_components_impl(result, graph, vertex_components, edge_components,
-                        vertex_components_shift, used, shift, i);
+        // an undirected edge is stored twice, it gets a component once
+        std::vector<Graph::EdgeType> skeleton_edges;
+        for (Graph::OrderType i = 0; i < graph->order(); ++i) {
+            for (auto child : skeleton_list[i]) {
+                if (graph->type() == Graph::Type::kDirected || i < child) {
+                    skeleton_edges.emplace_back(i, child);
+                }
             }
         }
-        result->shrink_order(shift);
-        return result;
-    }
-
-    void Generator::replace_with_components_impl(GraphPtr result, GraphPtr skeleton,
-            std::vector<GraphPtr> &vertex_components, std::vector<std::vector<GraphPtr>> &edge_components,
-            std::vector<size_t> &vertex_components_shift,
-            std::vector<char> &used, size_t &shift, size_t skeleton_vertex) {
-
-        used[skeleton_vertex] = true;
-        result->append_graph(vertex_components[skeleton_vertex], shift);
-        vertex_components_shift[skeleton_vertex] = shift;
-        shift += vertex_components[skeleton_vertex]->order();
-
-        auto edges = skeleton->adjacency_list().at(skeleton_vertex);
-        for (size_t i = 0; i < edges.size(); ++i) {
-            size_t child = edges[i];
-            if (!used[child]) {
-                replace_with_components_impl(result, skeleton, vertex_components, edge_components,
-                        vertex_components_shift, used, shift, child);
+        std::vector<GraphPtr> edge_components(skeleton_edges.size());
+        if (!skeleton_edges.empty()) {
+            if (edge_block) {
+                edge_components = generate_many(edge_block, skeleton_edges.size())->components();
             }
-            if (result->type() == Graph::Type::kDirected || result->type() == Graph::Type::kUndirected && skeleton_vertex < child) {
-                auto start_global = vertex_components[skeleton_vertex]->pick_anchor() + vertex_components_shift[skeleton_vertex];
-                auto finish_global = vertex_components[child]->pick_anchor() + vertex_components_shift[child];
-
-                auto edge_local = edge_components[skeleton_vertex][i]->pick_two_anchors();
-                auto start_local = edge_local.first;
-                auto finish_local = edge_local.second;
-
-                std::vector<std::pair<size_t, size_t>> except_vertices;
-                except_vertices.emplace_back(start_local, start_global);
-                except_vertices.emplace_back(finish_local, finish_global);
-                result->append_graph(edge_components[skeleton_vertex][i], shift, except_vertices);
-                shift += edge_components[skeleton_vertex][i]->order() - 2;
+            else {
+                for (auto &component : edge_components) {
+                    component = Graph::create(2, graph->type());
+                    component->add_edge(0, 1);
+                }
             }
         }
+
+        // vertex components are placed first, then edge components without their two anchors
+        std::vector<size_t> vertex_shift(vertex_components.size() + 1);
+        for (size_t i = 0; i < vertex_components.size(); ++i) {
+            vertex_shift[i + 1] = vertex_shift[i] + vertex_components[i]->order();
+        }
+        std::vector<size_t> edge_shift(edge_components.size() + 1, vertex_shift.back());
+        for (size_t i = 0; i < edge_components.size(); ++i) {
+            edge_shift[i + 1] = edge_shift[i] + edge_components[i]->order() - 2;
+        }
+
+        std::vector<Graph::Part> parts;
+        parts.reserve(vertex_components.size() + edge_components.size());
+        for (size_t i = 0; i < vertex_components.size(); ++i) {
+            parts.push_back(Graph::Part{vertex_components[i], vertex_shift[i], {}});
+        }
+        // anchors are drawn sequentially, so the result doesn't depend on the number of threads
+        for (size_t i = 0; i < edge_components.size(); ++i) {
+            auto start_global = vertex_components[skeleton_edges[i].first]->pick_anchor() +
+                    vertex_shift[skeleton_edges[i].first];
+            auto finish_global = vertex_components[skeleton_edges[i].second]->pick_anchor() +
+                    vertex_shift[skeleton_edges[i].second];
+            auto edge_local = edge_components[i]->pick_two_anchors();
+
+            std::vector<std::pair<size_t, size_t>> except_vertices;
+            except_vertices.emplace_back(edge_local.first, start_global);
+            except_vertices.emplace_back(edge_local.second, finish_global);
+            parts.push_back(Graph::Part{edge_components[i], edge_shift[i], except_vertices});
+        }
+
+        GraphPtr result = Graph::create(edge_shift.back(), graph->type());
+        result->append_graphs(parts);
+        return result;
     }
 
     // 'skeleton' is a tree with components.size() vertices
@@ -1175,7 +1512,7 @@ namespace graph_constraint_solver {
 
         std::vector<int> index_map(graph->order());
         std::iota(index_map.begin(), index_map.end(), 0);
-        std::shuffle(index_map.begin(), index_map.end(), random.rng());
+        random.shuffle(index_map.begin(), index_map.end());
         int current_idx = 0;
 
 
@@ -1,9 +1,15 @@
 #ifndef GRAPH_CONSTRAINT_SOLVER_GENERATOR_H
 #define GRAPH_CONSTRAINT_SOLVER_GENERATOR_H
 
+#include <map>
+#include <mutex>
+#include <tuple>
+#include <vector>
+
 #include "graph.h"
 #include "constraint.h"
 #include "constrained_graph.h"
+#include "edge_sink.h"
 #include "utils.h"
 
 namespace graph_constraint_solver {
@@ -12,39 +18,140 @@ namespace graph_constraint_solver {
     public:
         GraphComponentsPtr generate(ConstraintBlockPtr constraint_list_ptr);
         GraphComponentsPtr generate_block(ConstraintBlockPtr constraint_block_ptr);
+        // 'count' components of the block, each distributed as the first component of generate():
+        // constraints are read and analyzed once and the components are planned and built as one block
+        // the block's own component number bounds are ignored
+        GraphComponentsPtr generate_many(ConstraintBlockPtr constraint_block_ptr, size_t count);
 
         GraphComponentsPtr generate_two_connected_block(std::shared_ptr<TwoConnectedConstraintBlock> constraint_block_ptr);
-        GraphComponentsPtr generate_two_edge_connected_block(std::shared_ptr<TwoEdgeConnectedConstraintBlock> constraint_block_ptr,
-                bool check_satisfiability_only = false);
+        GraphComponentsPtr generate_two_edge_connected_block(std::shared_ptr<TwoEdgeConnectedConstraintBlock> constraint_block_ptr);
         GraphComponentsPtr generate_connected_block(std::shared_ptr<ConnectedConstraintBlock> constraint_block_ptr);
         GraphComponentsPtr generate_tree_block(std::shared_ptr<TreeConstraintBlock> constraint_block_ptr);
 
         GraphComponentsPtr generate_strongly_connected_block(std::shared_ptr<StronglyConnectedConstraintBlock> constraint_block_ptr);
 
+        // tree, two-connected and strongly-connected blocks without vertex/edge references can be streamed
+        // into a sink edge by edge, without building the graph; other blocks must be generated with generate()
+        bool supports_streaming(ConstraintBlockPtr constraint_block_ptr);
+        void generate_to_sink(ConstraintBlockPtr constraint_block_ptr, EdgeSink &sink);
+
+        // feasibility analysis decides from the bounds alone, nothing is generated and nothing is thrown
+        enum class Feasibility {
+            kFeasible,
+            kUnsatisfiable,
+        };
+
+        // values of a component parameter (cut points, bridges) the generator can realize,
+        // kept as disjoint intervals in increasing order
+        struct FeasibleValues {
+            Feasibility status = Feasibility::kUnsatisfiable;
+            std::vector<Constraint::SizeBounds> intervals;
+
+            // values must be added in increasing order
+            void add(Graph::SizeType value);
+            Graph::SizeType count() const;
+            // the index-th smallest value
+            Graph::SizeType at(Graph::SizeType index) const;
+        };
+
+        // numbers of cut points of a two-edge-connected component
+        static FeasibleValues two_edge_connected_feasibility(Constraint::OrderBounds order_bounds,
+                Constraint::SizeBounds size_bounds, Constraint::OrderBounds cut_point_bounds);
+        // numbers of bridges of a connected component
+        static FeasibleValues connected_feasibility(Constraint::OrderBounds order_bounds,
+                Constraint::SizeBounds size_bounds, Constraint::OrderBounds cut_point_bounds,
+                Constraint::SizeBounds bridge_bounds);
+
     private:
+        // the number of components of a block, 'component_number_override_' if it's set by generate_many,
+        // the override is reset by the first draw, so it applies only to the top-level block
+        Graph::OrderType draw_component_number(Constraint::OrderBounds component_number_bounds);
+        long long component_number_override_ = -1;
+
+        // results of the analyses are shared by all generators, blocks instantiated again and again
+        // (e.g. through vertex references) are analyzed once
+        // key: analysis, order, size, cut point and bridge bounds
+        using FeasibilityKey = std::tuple<int, Graph::OrderType, Graph::OrderType, Graph::SizeType, Graph::SizeType,
+                Graph::OrderType, Graph::OrderType, Graph::SizeType, Graph::SizeType>;
+        static FeasibleValues memoized_feasibility(const FeasibilityKey &key, const std::function<FeasibleValues()> &analyze);
+        static std::map<FeasibilityKey, FeasibleValues> feasibility_cache_;
+        static std::mutex feasibility_cache_mutex_;
+
+        // order and size of every component are chosen before any edge is generated,
+        // so a whole block can be announced to a sink before its edges are emitted
+        struct ComponentPlan {
+            using Emitter = std::function<void(EdgeSink &sink)>;
+
+            Graph::Type graph_type;
+            Graph::OrderType order;
+            Graph::SizeType size;
+            // emits exactly 'size' edges with vertices in [0, order)
+            Emitter emit;
+            // random stream of the emitter, split while planning, so components can be emitted in any order
+            Random::StreamId stream;
+
+            ComponentPlan(Graph::Type graph_type, Graph::OrderType order, Graph::SizeType size, Emitter emit);
+        };
+        using BlockPlan = std::vector<ComponentPlan>;
+
+        BlockPlan plan_block(ConstraintBlockPtr constraint_block_ptr);
+        BlockPlan plan_tree_block(std::shared_ptr<TreeConstraintBlock> constraint_block_ptr);
+        BlockPlan plan_two_connected_block(std::shared_ptr<TwoConnectedConstraintBlock> constraint_block_ptr);
+        BlockPlan plan_strongly_connected_block(std::shared_ptr<StronglyConnectedConstraintBlock> constraint_block_ptr);
+
+        void emit_component(ComponentPlan &plan, EdgeSink &sink);
+        GraphPtr build_component(ComponentPlan &plan);
+        // components are built in parallel and kept in plan order
+        GraphComponentsPtr build_components(BlockPlan &plan);
+
         // TODO: remove this 'go_with_the_winners' thing???
         using GoNext = std::function<void(ConstrainedGraphPtr)>;
         using GraphGenerator = std::function<ConstrainedGraphPtr()>;
         ConstrainedGraphPtr go_with_the_winners(GraphGenerator initial_graph_generator, GoNext go_next, bool to_print = false,
                 int colony_size = 5, int growth_rate = 2, int outer_iterations = 100, int inner_iterations = 10000);
 
-        GraphPtr generate_tree(Graph::Type graph_type, Constraint::OrderBounds order_bounds,
+        ComponentPlan plan_tree(Constraint::OrderBounds order_bounds,
                 Constraint::OrderBounds diameter_bounds, Graph::OrderType max_vertex_degree);
 
-        GraphPtr generate_tree_fixed_diameter(Graph::Type graph_type, Graph::OrderType order, Graph::OrderType diameter,
+        void generate_tree_fixed_diameter(EdgeSink &sink, Graph::OrderType order, Graph::OrderType diameter,
                 Graph::OrderType max_vertex_degree);
+        // uniform labeled tree: a random Prufer sequence decoded in linear time
+        // the sequence of a large tree is drawn in parallel chunks, each from its own stream
+        static const Graph::OrderType kPruferChunkSize = 1 << 16;
+        void generate_tree_uniform(EdgeSink &sink, Graph::OrderType order);
         GraphPtr generate_tree_fixed_leaves_number(Graph::OrderType order, Graph::OrderType leaves_number,
                 double merge_probability = 0.3);
 
-        GraphPtr generate_strongly_connected_component(Constraint::OrderBounds order_bounds,
+        // sizes a two-connected (strongly connected if directed) component of the given order can have,
+        // (-1, -1) if none of them is in 'size_bounds'
+        static Constraint::SizeBounds two_connected_size_bounds(Graph::Type graph_type, Graph::OrderType order,
+                Constraint::SizeBounds size_bounds);
+        // orders with a non-empty two_connected_size_bounds, both ends of the size range grow with the order,
+        // so they form an interval found by a binary search; (-1, -1) if there are none
+        static Constraint::OrderBounds two_connected_order_bounds(Graph::Type graph_type,
+                Constraint::OrderBounds order_bounds, Constraint::SizeBounds size_bounds);
+
+        // 'feasible_orders' is the block's two_connected_order_bounds, computed once for all its components
+        ComponentPlan plan_strongly_connected_component(Constraint::OrderBounds feasible_orders,
                 Constraint::SizeBounds size_bounds);
 
-        GraphPtr generate_two_connected_component(Graph::Type graph_type,
-                Constraint::OrderBounds components_order_bounds, Constraint::SizeBounds component_size_bounds);
+        ComponentPlan plan_two_connected_component(Graph::Type graph_type,
+                Constraint::OrderBounds feasible_orders, Constraint::SizeBounds size_bounds);
+
+        ComponentPlan plan_two_connected_component(Graph::Type graph_type, Graph::OrderType order, Graph::SizeType size,
+                Graph::OrderType min_loop_size, double loop_ear_probability = 0.0);
 
         GraphPtr generate_two_connected_component(Graph::Type graph_type, Graph::OrderType order, Graph::SizeType size,
                 Graph::OrderType min_loop_size, double loop_ear_probability = 0.0);
 
+        void generate_two_connected_component(EdgeSink &sink, Graph::Type graph_type, Graph::OrderType order,
+                Graph::SizeType size, Graph::OrderType min_loop_size, double loop_ear_probability);
+        // above this fraction of the complete graph's size chords are rarely new, so instead of ears
+        // a hamiltonian cycle is completed with chords sampled from all the other vertex pairs
+        static constexpr double kDenseTwoConnectedDensity = 0.5;
+        void generate_dense_two_connected_component(EdgeSink &sink, Graph::Type graph_type, Graph::OrderType order,
+                Graph::SizeType size);
+
         GraphPtr generate_two_edge_connected_component(Graph::Type graph_type, Graph::OrderType order,
                 Constraint::SizeBounds size_bounds, Graph::OrderType cut_points);
 
@@ -54,10 +161,6 @@ namespace graph_constraint_solver {
         // TODO: refactor all these DFSes
 
         GraphPtr replace_with_components(GraphPtr graph, ConstraintBlockPtr vertices_block, ConstraintBlockPtr edges_block);
-        void replace_with_components_impl(GraphPtr result, GraphPtr skeleton,
-                std::vector<GraphPtr> &vertex_components, std::vector<std::vector<GraphPtr>> &edge_components,
-                std::vector<size_t> &vertex_components_shift,
-                std::vector<char> &used, size_t &shift, size_t skeleton_vertex);
 
         void connect_components_in_vertices(GraphPtr graph, GraphComponentsPtr components, GraphPtr skeleton);
         void connect_components_in_vertices_dfs(GraphPtr graph, GraphComponentsPtr components, GraphPtr skeleton,
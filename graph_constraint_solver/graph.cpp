@@ -6,6 +6,24 @@
 
 namespace graph_constraint_solver {
 
+    namespace impl {
+        // global index of vertex 'index' of a graph appended at 'shift', 'except_vertices' (sorted by the local
+        // index) are mapped to the given global vertices and take no place
+        size_t transform_index(size_t index, size_t shift, const std::vector<std::pair<size_t, size_t>> &except_vertices) {
+            for (size_t i = 0; i < except_vertices.size(); ++i) {
+                if (except_vertices[i].first == index) {
+                    return except_vertices[i].second;
+                }
+            }
+            for (auto i = static_cast<Graph::OrderType>(except_vertices.size()) - 1; i >= 0; --i) {
+                if (index > except_vertices[i].first) {
+                    return shift + index - i - 1;
+                }
+            }
+            return shift + index;
+        }
+    }
+
     // Graph
 
     GraphPtr Graph::create(OrderType order, Graph::Type type) {
@@ -60,36 +78,57 @@ namespace graph_constraint_solver {
         if (shift + other->order() > order_) {
             throw std::runtime_error("append_graph error: can't append graph(not enough space)");
         }
-        auto transform_index = [&](size_t index) {
-            for (size_t i = 0; i < except_vertices.size(); ++i) {
-                if (except_vertices[i].first == index) {
-                    return except_vertices[i].second;
-                }
-            }
-            for (auto i = static_cast<Graph::OrderType>(except_vertices.size()) - 1; i >= 0; --i) {
-                if (index > except_vertices[i].first) {
-                    return shift + index - i - 1;
-                }
-            }
-            return shift + index;
-        };
-
-        auto adj_list = other->adjacency_list();
+        auto &adj_list = other->adjacency_list();
         for (size_t i = 0; i < other->order(); ++i) {
-            auto ii = transform_index(i);
+            auto ii = impl::transform_index(i, shift, except_vertices);
             for (auto edge : adj_list[i]) {
-                auto jj = transform_index(edge);
+                auto jj = impl::transform_index(edge, shift, except_vertices);
                 adjacency_list_[ii].emplace_back(jj);
             }
         }
         size_ += other->size();
     }
 
+    void Graph::append_graphs(const std::vector<Part> &parts) {
+        for (auto &part : parts) {
+            if (part.shift + part.graph->order() - part.except_vertices.size() > static_cast<size_t>(order_)) {
+                throw std::runtime_error("append_graphs error: can't append graph(not enough space)");
+            }
+        }
+
+        // rows of except vertices belong to other parts, their entries wait for the sequential pass
+        std::vector<std::vector<std::pair<size_t, OrderType>>> shared_entries(parts.size());
+        Utils::parallel_for(parts.size(), [&](size_t index) {
+            auto &part = parts[index];
+            auto &adj_list = part.graph->adjacency_list();
+            for (size_t i = 0; i < adj_list.size(); ++i) {
+                auto ii = impl::transform_index(i, part.shift, part.except_vertices);
+                auto shared = ii < part.shift || ii >= part.shift + adj_list.size() - part.except_vertices.size();
+                auto &row = adjacency_list_[ii];
+                for (auto edge : adj_list[i]) {
+                    OrderType jj = impl::transform_index(edge, part.shift, part.except_vertices);
+                    if (shared) {
+                        shared_entries[index].emplace_back(ii, jj);
+                    }
+                    else {
+                        row.emplace_back(jj);
+                    }
+                }
+            }
+        });
+        for (size_t index = 0; index < parts.size(); ++index) {
+            for (auto &[row, entry] : shared_entries[index]) {
+                adjacency_list_[row].emplace_back(entry);
+            }
+            size_ += parts[index].graph->size();
+        }
+    }
+
     void Graph::shuffle() {
         std::vector<std::vector<OrderType>> new_g(order_);
         std::vector<OrderType> index_map(order_);
         std::iota(index_map.begin(), index_map.end(), 0);
-        std::shuffle(index_map.begin(), index_map.end(), random.rng());
+        random.shuffle(index_map.begin(), index_map.end());
         for (OrderType i = 0; i < order_; ++i) {
             for (auto j : adjacency_list_[i]) {
                 new_g[index_map[i]].push_back(index_map[j]);
@@ -98,11 +137,6 @@ namespace graph_constraint_solver {
         adjacency_list_ = new_g;
     }
 
-    void Graph::shrink_order(size_t new_order) {
-        order_ = new_order;
-        adjacency_list_.resize(new_order);
-    }
-
     size_t Graph::pick_anchor() {
         return random.next(order_);
     }
@@ -46,8 +46,17 @@ namespace graph_constraint_solver {
         void add_edges(const std::vector<EdgeType> &edges);
         void append_graph(GraphPtr other, size_t shift,
                 std::vector<std::pair<size_t, size_t>> except_vertices = std::vector<std::pair<size_t, size_t>>());
+
+        struct Part {
+            GraphPtr graph;
+            size_t shift;
+            std::vector<std::pair<size_t, size_t>> except_vertices;
+        };
+        // append_graph for many parts, the parts are copied in parallel: a part writes only the rows of
+        // its own vertices, entries of except vertices' rows are added afterwards in the order of the parts
+        // the parts' own vertices must not overlap
+        void append_graphs(const std::vector<Part> &parts);
         void shuffle();
-        void shrink_order(size_t new_order);
 
         size_t pick_anchor();
         std::pair<size_t, size_t> pick_two_anchors();
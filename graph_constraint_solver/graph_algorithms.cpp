@@ -15,6 +15,49 @@ namespace graph_constraint_solver {
         impl::CutPointAlgorithm(graph_ptr, cut_points_number, cut_points_list);
     }
 
+    Graph::OrderType GraphAlgorithms::root_forest(GraphPtr graph_ptr, Graph::OrderType root,
+            std::vector<Graph::OrderType> &parent) {
+
+        auto order = graph_ptr->order();
+        if (order == 0) {
+            parent.clear();
+            return 0;
+        }
+        if (root < 0 || root >= order) {
+            throw std::invalid_argument("root_forest error: root " + std::to_string(root) + " is out of range");
+        }
+
+        // 'order' marks unvisited vertices, BFS queue is stored in 'queue' without popping
+        parent.assign(order, order);
+        std::vector<Graph::OrderType> queue;
+        queue.reserve(order);
+        Graph::OrderType components_number = 0;
+
+        auto bfs = [&](Graph::OrderType start) {
+            ++components_number;
+            parent[start] = -1;
+            auto head = queue.size();
+            queue.push_back(start);
+            for (; head < queue.size(); ++head) {
+                auto v = queue[head];
+                for (auto child : graph_ptr->adjacency_list()[v]) {
+                    if (parent[child] == order) {
+                        parent[child] = v;
+                        queue.push_back(child);
+                    }
+                }
+            }
+        };
+
+        bfs(root);
+        for (Graph::OrderType v = 0; v < order; ++v) {
+            if (parent[v] == order) {
+                bfs(v);
+            }
+        }
+        return components_number;
+    }
+
     namespace impl {
 
         // from stackoverflow
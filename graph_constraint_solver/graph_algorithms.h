@@ -11,6 +11,11 @@ namespace graph_constraint_solver {
 
         static void find_cut_points(GraphPtr graph_ptr, int &cut_points_number,
                 std::vector<int> &cut_points_list);
+
+        // iterative BFS, component of 'root' is rooted at 'root', every other component at its minimal vertex
+        // parent[root of a component] = -1, returns number of components
+        static Graph::OrderType root_forest(GraphPtr graph_ptr, Graph::OrderType root,
+                std::vector<Graph::OrderType> &parent);
     };
 
     namespace impl {
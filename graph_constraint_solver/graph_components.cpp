@@ -54,7 +54,10 @@ namespace graph_constraint_solver {
     }
 
     void GraphComponents::print(GraphPrinter::OutputFormat output_format, bool debug) {
-        auto graph = merge_components();
-        GraphPrinter(graph, output_format, debug);
+        GraphPrinter(components_, output_format, debug);
+    }
+
+    void GraphComponents::print(std::vector<GraphPrinter::OutputFormat> &output_formats, bool debug) {
+        GraphPrinter::print_all(components_, output_formats, debug);
     }
 }
\ No newline at end of file
@@ -19,6 +19,7 @@ namespace graph_constraint_solver {
 
         GraphPtr merge_components();
         void print(GraphPrinter::OutputFormat output_format, bool debug);
+        void print(std::vector<GraphPrinter::OutputFormat> &output_formats, bool debug);
 
     private:
         std::vector<GraphPtr> components_;
@@ -3,84 +3,772 @@
 #include <iostream>
 #include <fstream>
 #include <algorithm>
+#include <numeric>
+#include <charconv>
+#include <limits>
+#include <mutex>
+#include <condition_variable>
+#include <nlohmann/json.hpp>
 
 #include "graph_algorithms.h"
+#include "container.h"
+#include "output_template.h"
 #include "utils.h"
 
 namespace graph_constraint_solver {
 
+    namespace impl {
+        void TextBuffer::reserve(size_t capacity) {
+            buffer_.reserve(capacity);
+        }
+
+        void TextBuffer::clear() {
+            buffer_.clear();
+        }
+
+        size_t TextBuffer::size() {
+            return buffer_.size();
+        }
+
+        const char* TextBuffer::data() {
+            return buffer_.data();
+        }
+
+        void TextBuffer::append(char c) {
+            buffer_.push_back(c);
+        }
+
+        void TextBuffer::append(const char *s, size_t length) {
+            buffer_.append(s, length);
+        }
+
+        void TextBuffer::append_number(long long value) {
+            char digits[24];
+            auto result = std::to_chars(digits, digits + sizeof(digits), value);
+            buffer_.append(digits, result.ptr - digits);
+        }
+
+        void TextBuffer::append_little_endian(unsigned long long value, size_t width) {
+            for (size_t i = 0; i < width; ++i) {
+                buffer_.push_back(static_cast<char>(value & 0xff));
+                value >>= 8;
+            }
+        }
+
+        ComponentsView::ComponentsView(std::vector<GraphPtr> components, bool shuffle)
+            : components_(std::move(components)), shift_(1, 0), size_(0) {
+
+            for (auto &component : components_) {
+                shift_.push_back(shift_.back() + component->order());
+                size_ += component->size();
+            }
+            if (shuffle) {
+                // same relabeling as Graph::shuffle: merged vertex v gets index label_[v]
+                label_.resize(order());
+                std::iota(label_.begin(), label_.end(), 0);
+                random.shuffle(label_.begin(), label_.end());
+                vertex_.resize(order());
+                for (Graph::OrderType v = 0; v < order(); ++v) {
+                    vertex_[label_[v]] = v;
+                }
+            }
+        }
+
+        Graph::Type ComponentsView::type() {
+            return components_.empty() ? Graph::Type::kUndirected : components_.front()->type();
+        }
+
+        Graph::OrderType ComponentsView::order() {
+            return shift_.back();
+        }
+
+        Graph::SizeType ComponentsView::size() {
+            return size_;
+        }
+
+        bool ComponentsView::empty() {
+            return order() == 0;
+        }
+
+        std::vector<GraphPtr>& ComponentsView::components() {
+            return components_;
+        }
+
+        Graph::OrderType ComponentsView::shift(size_t component_index) {
+            return shift_[component_index];
+        }
+
+        size_t ComponentsView::component_index(Graph::OrderType merged_vertex) {
+            if (components_.size() == 1) return 0;
+            return std::upper_bound(shift_.begin(), shift_.end(), merged_vertex) - shift_.begin() - 1;
+        }
+
+        ComponentsView::Row ComponentsView::row(Graph::OrderType index) {
+            auto v = vertex(index);
+            auto component = component_index(v);
+            return Row{components_[component]->adjacency_list()[v - shift_[component]], shift_[component]};
+        }
+
+        void ComponentsView::row_labels(Graph::OrderType index, bool skip_smaller, bool sorted,
+                std::vector<Graph::OrderType> &labels) {
+
+            labels.clear();
+            auto current_row = row(index);
+            for (auto child : current_row.adjacency) {
+                auto j = label(current_row.shift + child);
+                if (skip_smaller && j < index) {
+                    continue;
+                }
+                labels.push_back(j);
+            }
+            // rows are visited by ascending index, so sorting every row sorts the whole edge list
+            if (sorted) {
+                std::sort(labels.begin(), labels.end());
+            }
+        }
+
+        Graph::OrderType ComponentsView::label(Graph::OrderType merged_vertex) {
+            return label_.empty() ? merged_vertex : label_[merged_vertex];
+        }
+
+        Graph::OrderType ComponentsView::vertex(Graph::OrderType index) {
+            return vertex_.empty() ? index : vertex_[index];
+        }
+
+        GraphPtr ComponentsView::merge() {
+            auto graph = Graph::create(order(), type());
+            for (size_t i = 0; i < components_.size(); ++i) {
+                graph->append_graph(components_[i], shift_[i]);
+            }
+            return graph;
+        }
+    }
+
     const GraphPrinter::OutputFormat::Filepath GraphPrinter::OutputFormat::kDefaultFilepath = "";
 
-    GraphPrinter::OutputFormat::OutputFormat(Structure structure, Indexation indexation, Filepath filepath)
-        : structure(structure), indexation(indexation), filepath(filepath) {
+    GraphPrinter::OutputFormat::OutputFormat(Structure structure, Indexation indexation, Filepath filepath, bool debug,
+            Root root, Compression compression, bool shuffle, bool sorted, Shards shards,
+            std::shared_ptr<const OutputTemplate> layout, bool container)
+        : structure(structure), indexation(indexation), filepath(filepath), debug(debug), root(root),
+        compression(compression), shuffle(shuffle), sorted(sorted), shards(shards), layout(layout),
+        container(container) {
 
     }
 
-    std::ostream& GraphPrinter::output() {
-        return output_file_.badbit ? std::cout : output_file_;
+    const char* const GraphPrinter::kManifestExtension = ".manifest";
+
+    GraphPrinter::OutputFormat::Filepath GraphPrinter::shard_filepath(const OutputFormat::Filepath &filepath,
+            size_t shard, size_t shards) {
+
+        const size_t kMinimumDigits = 3;
+        auto digits = std::max(kMinimumDigits, std::to_string(shards - 1).size());
+        auto number = std::to_string(shard);
+        return filepath + "." + std::string(digits - number.size(), '0') + number;
     }
 
-    GraphPrinter::GraphPrinter(GraphPtr graph, OutputFormat &output_format, bool debug) {
-        if (!output_format.filepath.empty()) {
-            output_file_.exceptions(std::ofstream::failbit | std::ofstream::badbit);
-            output_file_.open(output_format.filepath, std::ofstream::out);
-            if (!output_file_) {
-                throw std::runtime_error("Can't open file " + output_format.filepath);
+    void GraphPrinter::write(impl::TextBuffer &buffer) {
+        output_stream_->write(buffer.data(), buffer.size());
+    }
+
+    void GraphPrinter::print_line(std::initializer_list<long long> numbers) {
+        impl::TextBuffer buffer;
+        for (auto number : numbers) {
+            if (buffer.size()) {
+                buffer.append(' ');
             }
+            buffer.append_number(number);
         }
-        std::ios_base::sync_with_stdio(false);
+        buffer.append('\n');
+        write(buffer);
+    }
+
+    void GraphPrinter::print_chunks(impl::ComponentsView &graph, ChunkFormatter formatter, size_t vertex_cost) {
+        std::vector<Graph::OrderType> bounds(1, 0);
+        size_t current_chunk_size = 0;
+        for (Graph::OrderType i = 0; i < graph.order(); ++i) {
+            current_chunk_size += graph.row(i).adjacency.size() + vertex_cost;
+            if (current_chunk_size >= kChunkAdjacencySize) {
+                bounds.push_back(i + 1);
+                current_chunk_size = 0;
+            }
+        }
+        if (bounds.back() != graph.order()) {
+            bounds.push_back(graph.order());
+        }
+
+        // one parallel_for runs over all chunks, chunk i is formatted into buffer i % window once chunk
+        // i - window is written, so at most 'window' buffers are alive at once
+        // finished chunks are written in order by whichever worker finds the next one ready, the others keep formatting
+        auto chunks_number = bounds.size() - 1;
+        auto window = 2 * std::min(chunks_number, Utils::hardware_threads());
+        std::vector<impl::TextBuffer> buffers(window);
+        std::vector<std::string> scratch(window);
+        std::vector<char> ready(chunks_number);
+        size_t written = 0;
+        bool writing = false;
+        bool failed = false;
+        std::mutex mutex;
+        std::condition_variable written_changed;
+
+        auto write_ready = [&](std::unique_lock<std::mutex> &lock) {
+            if (writing) return;
+            writing = true;
+            while (!failed && written < chunks_number && ready[written]) {
+                auto &buffer = buffers[written % window];
+                lock.unlock();
+                try {
+                    write(buffer);
+                }
+                catch (...) {
+                    lock.lock();
+                    writing = false;
+                    throw;
+                }
+                lock.lock();
+                ++written;
+                written_changed.notify_all();
+            }
+            writing = false;
+        };
+
+        Utils::parallel_for(chunks_number, [&](size_t chunk) {
+            try {
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    written_changed.wait(lock, [&]() { return failed || chunk < written + window; });
+                    if (failed) return;
+                }
+                auto &buffer = buffers[chunk % window];
+                buffer.clear();
+                formatter(bounds[chunk], bounds[chunk + 1], buffer, scratch[chunk % window]);
+
+                std::unique_lock<std::mutex> lock(mutex);
+                ready[chunk] = true;
+                write_ready(lock);
+            }
+            catch (...) {
+                std::lock_guard<std::mutex> lock(mutex);
+                failed = true;
+                written_changed.notify_all();
+                throw;
+            }
+        });
+    }
+
+    void GraphPrinter::open(OutputFormat &output_format) {
+        // printers may be opened concurrently, the streams are switched once
+        [[maybe_unused]] static const bool kUnsynchronized = []() {
+            std::ios_base::sync_with_stdio(false);
+            return true;
+        }();
 //        std::cin.tie(0);
 
-        if (!debug) {
-            if (graph->type() == Graph::Type::kUndirected) {
-                print_undirected(graph, output_format);
+        layout_ = output_format.layout ? output_format.layout : std::make_shared<OutputTemplate>();
+        if (layout_->needs_salt()) {
+            layout_ = layout_->salted(random.next(std::numeric_limits<long long>::max()));
+        }
+
+        manifest_ = output_format.manifest;
+        filepath_ = output_format.filepath;
+
+        // sharded output opens its part files itself
+        if (output_format.shards > 1) return;
+        output_stream_ = open_stream(output_format.filepath, output_format.compression, output_format.container,
+                manifest_ ? &hashing_ : nullptr);
+    }
+
+    OutputStreamPtr GraphPrinter::open_stream(const OutputFormat::Filepath &filepath,
+            OutputFormat::Compression compression, bool container, HashingOutputStream **hashing) {
+
+        OutputStreamPtr output_stream;
+        if (container) {
+            output_stream = std::make_unique<ContainerOutputStream>(filepath, random.seed());
+        }
+        else {
+            output_stream = std::make_unique<FileOutputStream>(filepath);
+        }
+        if (hashing) {
+            auto hashing_stream = std::make_unique<HashingOutputStream>(std::move(output_stream));
+            *hashing = hashing_stream.get();
+            output_stream = std::move(hashing_stream);
+        }
+        if (compression == OutputFormat::Compression::kGzip) {
+            output_stream = std::make_unique<GzipOutputStream>(std::move(output_stream));
+        }
+        return output_stream;
+    }
+
+    void GraphPrinter::close_stream() {
+        if (!output_stream_) return;
+        output_stream_->close();
+        if (manifest_) {
+            manifest_->append(filepath_, printed_order_, printed_size_, hashing_->length(), hashing_->digest());
+        }
+    }
+
+    GraphPrinter::GraphPrinter(GraphPtr graph, OutputFormat &output_format, bool debug)
+        : GraphPrinter(std::vector<GraphPtr>{graph}, output_format, debug) {
+
+    }
+
+    GraphPrinter::GraphPrinter(const std::vector<GraphPtr> &components, OutputFormat &output_format, bool debug) {
+        open(output_format);
+        impl::ComponentsView graph(components, output_format.shuffle && !debug);
+        print(graph, output_format, debug);
+        close_stream();
+    }
+
+    GraphPrinter::GraphPrinter(impl::ComponentsView &graph, OutputFormat &output_format, bool debug) {
+        open(output_format);
+        print(graph, output_format, debug);
+        close_stream();
+    }
+
+    void GraphPrinter::print_all(const std::vector<GraphPtr> &components, std::vector<OutputFormat> output_formats,
+            bool debug) {
+
+        // views are only built when some output needs them, in the same order the single printer would draw them
+        std::unique_ptr<impl::ComponentsView> plain_graph, shuffled_graph;
+        auto view = [&](OutputFormat &output_format, bool output_debug) -> impl::ComponentsView& {
+            auto &graph = output_format.shuffle && !output_debug ? shuffled_graph : plain_graph;
+            if (!graph) {
+                graph = std::make_unique<impl::ComponentsView>(components, output_format.shuffle && !output_debug);
+            }
+            return *graph;
+        };
+
+        OutputFormat::Root random_root = OutputFormat::kRandomRoot;
+        unsigned long long layout_salt = 0;
+        bool layout_salt_drawn = false;
+        std::vector<size_t> concurrent, sequential;
+        for (size_t i = 0; i < output_formats.size(); ++i) {
+            auto &output_format = output_formats[i];
+            auto output_debug = debug || output_format.debug;
+            auto &graph = view(output_format, output_debug);
+            // printers running concurrently must not touch the global random
+            if (!output_debug && output_format.structure == OutputFormat::Structure::kParentArray &&
+                    output_format.root == OutputFormat::kRandomRoot && !graph.empty()) {
+                if (random_root == OutputFormat::kRandomRoot) {
+                    random_root = random.next(graph.order());
+                }
+                output_format.root = random_root;
+            }
+            // outputs with the same weighted template print the same weights
+            if (output_format.layout && output_format.layout->needs_salt()) {
+                if (!layout_salt_drawn) {
+                    layout_salt = random.next(std::numeric_limits<long long>::max());
+                    layout_salt_drawn = true;
+                }
+                output_format.layout = output_format.layout->salted(layout_salt);
+            }
+            if (output_debug || output_format.filepath.empty()) {
+                sequential.push_back(i);
             }
-            else if (graph->type() == Graph::Type::kDirected) {
-                print_directed(graph, output_format);
+            else {
+                concurrent.push_back(i);
             }
         }
+
+        Utils::parallel_for(concurrent.size(), [&](size_t index) {
+            auto &output_format = output_formats[concurrent[index]];
+            GraphPrinter(view(output_format, debug || output_format.debug), output_format,
+                    debug || output_format.debug);
+        });
+        for (auto index : sequential) {
+            auto &output_format = output_formats[index];
+            GraphPrinter(view(output_format, debug || output_format.debug), output_format,
+                    debug || output_format.debug);
+        }
+    }
+
+    void GraphPrinter::print(impl::ComponentsView &graph, OutputFormat &output_format, bool debug) {
+        printed_order_ = graph.order();
+        printed_size_ = graph.size();
+        if (!debug && output_format.shards > 1) {
+            print_sharded_edge_list(graph, output_format);
+        }
+        else if (!debug && output_format.structure == OutputFormat::Structure::kBinaryEdgeList) {
+            print_binary_edge_list(graph, output_format);
+        }
+        else if (!debug && output_format.structure == OutputFormat::Structure::kBinaryCSR) {
+            print_binary_csr(graph, output_format);
+        }
+        else if (!debug && output_format.structure == OutputFormat::Structure::kAdjMatrix) {
+            print_adjacency_matrix(graph);
+        }
+        else if (!debug && output_format.structure == OutputFormat::Structure::kBinaryAdjMatrix) {
+            print_binary_adjacency_matrix(graph);
+        }
+        else if (!debug && output_format.structure == OutputFormat::Structure::kParentArray) {
+            print_parent_array(graph, output_format);
+        }
+        else if (!debug) {
+            print_edge_list(graph, output_format);
+        }
         else {
-            if (graph->type() == Graph::Type::kUndirected) {
-                print_undirected_debug(graph, output_format);
+            // debug output is diagnostics only, it's printed from a merged graph and never shuffled
+            auto merged_graph = graph.merge();
+            if (merged_graph->type() == Graph::Type::kUndirected) {
+                print_undirected_debug(merged_graph, output_format);
             }
-            else if (graph->type() == Graph::Type::kDirected) {
-                print_directed_debug(graph, output_format);
+            else if (merged_graph->type() == Graph::Type::kDirected) {
+                print_directed_debug(merged_graph, output_format);
             }
         }
     }
 
-    void GraphPrinter::print_undirected(GraphPtr graph, OutputFormat &output_format) {
-        if (graph->empty()) return;
+    GraphPrinter::GraphPrinter(OutputFormat &output_format) {
+        open(output_format);
+        edge_list_sink_ = std::make_unique<EdgeListSink>(*this, output_format);
+    }
+
+    EdgeSink& GraphPrinter::edge_list_sink() {
+        return *edge_list_sink_;
+    }
+
+    void GraphPrinter::close() {
+        close_stream();
+    }
+
+    GraphPrinter::EdgeListSink::EdgeListSink(GraphPrinter &printer, OutputFormat &output_format)
+        : printer_(printer),
+        add_to_index_(output_format.indexation == GraphPrinter::OutputFormat::Indexation::kOneBased),
+        shuffle_(output_format.shuffle) {
+
+        buffer_.reserve(kStreamBufferSize);
+    }
+
+    void GraphPrinter::EdgeListSink::begin(Graph::Type, Graph::OrderType order, Graph::SizeType size) {
+        printer_.printed_order_ = order;
+        printer_.printed_size_ = size;
+        // begin() is called from inside the generation, the relabeling is drawn like for a generated graph
+        auto root = random.root_stream();
+        // same as print_edge_list: nothing is printed for an empty graph
+        if (order == 0) return;
+        if (shuffle_) {
+            label_.resize(order);
+            std::iota(label_.begin(), label_.end(), 0);
+            random.shuffle(label_.begin(), label_.end());
+        }
+        if (printer_.layout_->has_header()) {
+            printer_.layout_->append_header(buffer_, order, size);
+        }
+    }
+
+    void GraphPrinter::EdgeListSink::consume_edge(Graph::OrderType from, Graph::OrderType to) {
+        if (shuffle_) {
+            from = label_[from];
+            to = label_[to];
+        }
+        printer_.layout_->append_edge(buffer_, from, to, add_to_index_);
+        if (buffer_.size() >= kStreamBufferSize) {
+            printer_.write(buffer_);
+            buffer_.clear();
+        }
+    }
+
+    void GraphPrinter::EdgeListSink::end() {
+        printer_.write(buffer_);
+        buffer_.clear();
+    }
+
+    Graph::SizeType GraphPrinter::format_edges(impl::ComponentsView &graph, OutputFormat &output_format,
+            size_t index_width, Graph::OrderType first, Graph::OrderType last, impl::TextBuffer &buffer) {
+
         size_t add_to_index = output_format.indexation == GraphPrinter::OutputFormat::Indexation::kOneBased;
-        // now only print adj_list
+        bool binary = output_format.structure == OutputFormat::Structure::kBinaryEdgeList;
+        bool undirected = graph.type() == Graph::Type::kUndirected;
+        Graph::SizeType edges_number = 0;
+        std::vector<Graph::OrderType> labels;
+        for (auto i = first; i < last; ++i) {
+            graph.row_labels(i, undirected, output_format.sorted, labels);
+            edges_number += labels.size();
+            for (auto j : labels) {
+                if (binary) {
+                    buffer.append_little_endian(i + add_to_index, index_width);
+                    buffer.append_little_endian(j + add_to_index, index_width);
+                }
+                else {
+                    layout_->append_edge(buffer, i, j, add_to_index);
+                }
+            }
+        }
+        return edges_number;
+    }
 
-        //  TODO: OutputFormat parameter to specify whether we need to print 'order' and 'size'
-        output() << graph->order() << " " << graph->size() << "\n";
-//        output() << graph->order() << " " << graph->size() << "\n";
+    void GraphPrinter::print_edge_list(impl::ComponentsView &graph, OutputFormat &output_format) {
+        if (graph.empty()) return;
 
-        for (int i = 0; i < graph->order(); ++i) {
-            for (auto child : graph->adjacency_list().at(i)) {
-                if (i > child) {
-                    continue;
+        if (layout_->has_header()) {
+            impl::TextBuffer buffer;
+            layout_->append_header(buffer, graph.order(), graph.size());
+            write(buffer);
+        }
+
+        print_chunks(graph, [&](Graph::OrderType first, Graph::OrderType last, impl::TextBuffer &buffer,
+                std::string &) {
+            format_edges(graph, output_format, 0, first, last, buffer);
+        });
+    }
+
+    size_t GraphPrinter::binary_index_width(impl::ComponentsView &graph, size_t add_to_index) {
+        const unsigned long long kMaximumNarrowIndex = 0xffffffffULL;
+        auto adjacency_size = static_cast<unsigned long long>(graph.size());
+        if (graph.type() == Graph::Type::kUndirected) {
+            adjacency_size *= 2;
+        }
+        auto maximum_index = std::max<unsigned long long>(graph.order() + add_to_index, adjacency_size);
+        return maximum_index <= kMaximumNarrowIndex ? 4 : 8;
+    }
+
+    void GraphPrinter::print_binary_header(impl::ComponentsView &graph, size_t index_width,
+            unsigned long long payload_size) {
+
+        output_stream_->reserve(kBinaryHeaderSize + payload_size);
+        impl::TextBuffer buffer;
+        buffer.append_little_endian(graph.order(), kBinaryHeaderFieldWidth);
+        buffer.append_little_endian(graph.size(), kBinaryHeaderFieldWidth);
+        buffer.append_little_endian(graph.type() == Graph::Type::kDirected, kBinaryHeaderFieldWidth);
+        buffer.append_little_endian(index_width, kBinaryHeaderFieldWidth);
+        write(buffer);
+    }
+
+    void GraphPrinter::print_binary_edge_list(impl::ComponentsView &graph, OutputFormat &output_format) {
+        size_t add_to_index = output_format.indexation == GraphPrinter::OutputFormat::Indexation::kOneBased;
+        auto index_width = binary_index_width(graph, add_to_index);
+        print_binary_header(graph, index_width, 2ULL * index_width * graph.size());
+
+        print_chunks(graph, [&](Graph::OrderType first, Graph::OrderType last, impl::TextBuffer &buffer,
+                std::string &) {
+            format_edges(graph, output_format, index_width, first, last, buffer);
+        });
+    }
+
+    void GraphPrinter::print_sharded_edge_list(impl::ComponentsView &graph, OutputFormat &output_format) {
+        bool binary = output_format.structure == OutputFormat::Structure::kBinaryEdgeList;
+        if (!binary && output_format.structure != OutputFormat::Structure::kEdgeList) {
+            throw std::runtime_error("GraphPrinter error: only edge lists can be sharded");
+        }
+        size_t add_to_index = output_format.indexation == GraphPrinter::OutputFormat::Indexation::kOneBased;
+        size_t index_width = binary ? binary_index_width(graph, add_to_index) : 0;
+        auto shards = output_format.shards;
+
+        // shards are contiguous vertex ranges with about the same number of adjacency entries
+        unsigned long long adjacency_size = 0;
+        for (Graph::OrderType i = 0; i < graph.order(); ++i) {
+            adjacency_size += graph.row(i).adjacency.size();
+        }
+        std::vector<Graph::OrderType> bounds(1, 0);
+        unsigned long long current_size = 0;
+        for (Graph::OrderType i = 0; i < graph.order() && bounds.size() < shards; ++i) {
+            current_size += graph.row(i).adjacency.size();
+            if (current_size * shards >= adjacency_size * bounds.size()) {
+                bounds.push_back(i + 1);
+            }
+        }
+        while (bounds.size() <= shards) {
+            bounds.push_back(graph.order());
+        }
+        bounds.back() = graph.order();
+
+        std::vector<Graph::SizeType> shard_size(shards);
+        std::vector<std::pair<unsigned long long, unsigned long long>> shard_hash(shards);
+        Utils::parallel_for(shards, [&](size_t shard) {
+            HashingOutputStream *hashing = nullptr;
+            auto output_stream = open_stream(shard_filepath(output_format.filepath, shard, shards),
+                    output_format.compression, false, manifest_ ? &hashing : nullptr);
+            impl::TextBuffer buffer;
+            auto first = bounds[shard];
+            while (first < bounds[shard + 1]) {
+                auto last = first;
+                size_t chunk_size = 0;
+                while (last < bounds[shard + 1] && chunk_size < kChunkAdjacencySize) {
+                    chunk_size += graph.row(last++).adjacency.size() + 1;
                 }
-                output() << i + add_to_index << " " << child + add_to_index << "\n";
+                shard_size[shard] += format_edges(graph, output_format, index_width, first, last, buffer);
+                output_stream->write(buffer.data(), buffer.size());
+                buffer.clear();
+                first = last;
             }
+            output_stream->close();
+            if (hashing) {
+                shard_hash[shard] = {hashing->length(), hashing->digest()};
+            }
+        });
+        // every shard is recorded with its own edges, in shard order
+        if (manifest_) {
+            for (size_t shard = 0; shard < shards; ++shard) {
+                manifest_->append(shard_filepath(output_format.filepath, shard, shards), graph.order(), shard_size[shard],
+                        shard_hash[shard].first, shard_hash[shard].second);
+            }
+        }
+
+        nlohmann::json manifest;
+        manifest["order"] = graph.order();
+        manifest["size"] = graph.size();
+        manifest["directed"] = graph.type() == Graph::Type::kDirected;
+        manifest["one-based"] = static_cast<bool>(add_to_index);
+        manifest["binary"] = binary;
+        if (binary) {
+            manifest["index-width"] = index_width;
+        }
+        manifest["shards"] = nlohmann::json::array();
+        for (size_t shard = 0; shard < shards; ++shard) {
+            auto filepath = shard_filepath(output_format.filepath, shard, shards);
+            // loaders resolve shards relative to the manifest
+            manifest["shards"].push_back({{"file", filepath.substr(filepath.rfind('/') + 1)},
+                                          {"edges", shard_size[shard]}});
         }
+        auto text = manifest.dump(4) + "\n";
+        auto output_stream = open_stream(output_format.filepath + kManifestExtension, OutputFormat::Compression::kNone);
+        output_stream->write(text.data(), text.size());
+        output_stream->close();
     }
 
-    void GraphPrinter::print_directed(GraphPtr graph, OutputFormat &output_format) {
-        if (graph->empty()) return;
+    void GraphPrinter::print_binary_csr(impl::ComponentsView &graph, OutputFormat &output_format) {
         size_t add_to_index = output_format.indexation == GraphPrinter::OutputFormat::Indexation::kOneBased;
-        // now only print adj_list
+        auto index_width = binary_index_width(graph, add_to_index);
+        unsigned long long adjacency_size = 0;
+        for (auto &component : graph.components()) {
+            for (auto &list : component->adjacency_list()) {
+                adjacency_size += list.size();
+            }
+        }
+        print_binary_header(graph, index_width, index_width * (graph.order() + 1 + adjacency_size));
 
-        //  TODO: OutputFormat parameter to specify whether we need to print 'order' and 'size'
-        output() << graph->order() << " " << graph->size() << "\n";
+        // offsets are prefix sums, so they are formatted sequentially but still flushed chunk by chunk
+        impl::TextBuffer buffer;
+        unsigned long long offset = 0;
+        buffer.append_little_endian(offset, index_width);
+        for (Graph::OrderType i = 0; i < graph.order(); ++i) {
+            offset += graph.row(i).adjacency.size();
+            buffer.append_little_endian(offset, index_width);
+            if (buffer.size() >= kChunkAdjacencySize * index_width) {
+                write(buffer);
+                buffer.clear();
+            }
+        }
+        write(buffer);
 
-        for (int i = 0; i < graph->order(); ++i) {
-            for (auto child : graph->adjacency_list().at(i)) {
-                output() << i + add_to_index << " " << child + add_to_index << "\n";
+        print_chunks(graph, [&](Graph::OrderType first, Graph::OrderType last, impl::TextBuffer &buffer,
+                std::string &) {
+            std::vector<Graph::OrderType> labels;
+            for (auto i = first; i < last; ++i) {
+                graph.row_labels(i, false, output_format.sorted, labels);
+                for (auto j : labels) {
+                    buffer.append_little_endian(j + add_to_index, index_width);
+                }
+            }
+        });
+    }
+
+    void GraphPrinter::print_adjacency_matrix(impl::ComponentsView &graph) {
+        if (graph.empty()) return;
+        print_line({graph.order()});
+
+        auto order = graph.order();
+        print_chunks(graph, [&](Graph::OrderType first, Graph::OrderType last, impl::TextBuffer &buffer,
+                std::string &matrix_row) {
+            // "0 0 ... 0\n", cell j is at position 2 * j, the row is built once per slot
+            if (matrix_row.empty()) {
+                matrix_row.assign(2 * static_cast<size_t>(order), ' ');
+                for (Graph::OrderType j = 0; j < order; ++j) {
+                    matrix_row[2 * j] = '0';
+                }
+                matrix_row.back() = '\n';
+            }
+
+            for (auto i = first; i < last; ++i) {
+                auto row = graph.row(i);
+                for (auto child : row.adjacency) {
+                    matrix_row[2 * static_cast<size_t>(graph.label(row.shift + child))] = '1';
+                }
+                buffer.append(matrix_row.data(), matrix_row.size());
+                for (auto child : row.adjacency) {
+                    matrix_row[2 * static_cast<size_t>(graph.label(row.shift + child))] = '0';
+                }
+            }
+        }, 2 * order);
+    }
+
+    void GraphPrinter::print_binary_adjacency_matrix(impl::ComponentsView &graph) {
+        auto order = graph.order();
+        auto row_bytes = (static_cast<size_t>(order) + 7) / 8;
+        print_binary_header(graph, 0, static_cast<unsigned long long>(order) * row_bytes);
+
+        print_chunks(graph, [&](Graph::OrderType first, Graph::OrderType last, impl::TextBuffer &buffer,
+                std::string &matrix_row) {
+            if (matrix_row.empty()) {
+                matrix_row.assign(row_bytes, 0);
+            }
+            for (auto i = first; i < last; ++i) {
+                auto row = graph.row(i);
+                for (auto child : row.adjacency) {
+                    auto j = graph.label(row.shift + child);
+                    matrix_row[j / 8] |= static_cast<char>(1 << (j % 8));
+                }
+                buffer.append(matrix_row.data(), matrix_row.size());
+                for (auto child : row.adjacency) {
+                    matrix_row[graph.label(row.shift + child) / 8] = 0;
+                }
+            }
+        }, row_bytes);
+    }
+
+    void GraphPrinter::print_parent_array(impl::ComponentsView &graph, OutputFormat &output_format) {
+        if (graph.empty()) return;
+        if (graph.type() != Graph::Type::kUndirected) {
+            throw std::runtime_error("GraphPrinter error: parent-array output requires an undirected graph");
+        }
+        size_t add_to_index = output_format.indexation == GraphPrinter::OutputFormat::Indexation::kOneBased;
+
+        auto root = output_format.root;
+        if (root == OutputFormat::kRandomRoot) {
+            root = random.next(graph.order());
+        }
+        if (root < 0 || root >= graph.order()) {
+            throw std::runtime_error("GraphPrinter error: parent-array root " + std::to_string(root + add_to_index) +
+            " is out of range " + Utils::segment_to_string(add_to_index, graph.order() - 1 + add_to_index));
+        }
+
+        // every component is rooted on its own, the one holding the root from it and the others from their first vertex
+        // parents are kept in merged indices
+        auto merged_root = graph.vertex(root);
+        auto root_component = graph.component_index(merged_root);
+        std::vector<Graph::OrderType> parent(graph.order());
+        std::vector<Graph::OrderType> component_parent;
+        Graph::OrderType components_number = 0;
+        for (size_t i = 0; i < graph.components().size(); ++i) {
+            auto component = graph.components()[i];
+            if (component->empty()) continue;
+            auto shift = graph.shift(i);
+            components_number += GraphAlgorithms::root_forest(component,
+                    i == root_component ? merged_root - shift : 0, component_parent);
+            for (Graph::OrderType v = 0; v < component->order(); ++v) {
+                parent[shift + v] = component_parent[v] == -1 ? -1 : shift + component_parent[v];
+            }
+        }
+        if (graph.size() != graph.order() - components_number) {
+            throw std::runtime_error("GraphPrinter error: parent-array output requires a forest");
+        }
+
+        impl::TextBuffer buffer;
+        buffer.append_number(graph.order());
+        buffer.append('\n');
+        for (Graph::OrderType i = 0; i < graph.order(); ++i) {
+            if (i) {
+                buffer.append(' ');
+            }
+            auto vertex_parent = parent[graph.vertex(i)];
+            buffer.append_number((vertex_parent == -1 ? -1 : graph.label(vertex_parent)) +
+                    static_cast<long long>(add_to_index));
+            if (buffer.size() >= kChunkAdjacencySize) {
+                write(buffer);
+                buffer.clear();
             }
         }
+        buffer.append('\n');
+        write(buffer);
     }
 
     void GraphPrinter::print_undirected_debug(GraphPtr graph, OutputFormat &output_format) {
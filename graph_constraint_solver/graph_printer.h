@@ -3,10 +3,78 @@
 
 #include <iostream>
 #include <fstream>
+#include <functional>
+#include <string>
 
 #include "graph.h"
+#include "edge_sink.h"
+#include "output_stream.h"
+#include "manifest.h"
 
 namespace graph_constraint_solver {
+    namespace impl {
+        // growing byte buffer with a fast integer formatter, used instead of std::ostream::operator<<
+        class TextBuffer {
+        public:
+            void reserve(size_t capacity);
+            void clear();
+            size_t size();
+            const char* data();
+
+            void append(char c);
+            void append(const char *s, size_t length);
+            void append_number(long long value);
+            // lowest 'width' bytes of the value, least significant first
+            void append_little_endian(unsigned long long value, size_t width);
+
+        private:
+            std::string buffer_;
+        };
+
+        // components printed as one graph without merging them: vertices of a component are shifted
+        // by the total order of the components before it, then optionally relabeled by a random permutation
+        // vertices are visited by their printed index, neighbors are mapped to printed indices with label()
+        class ComponentsView {
+        public:
+            struct Row {
+                const std::vector<Graph::OrderType> &adjacency;
+                // neighbors in 'adjacency' are local to the component, 'shift + child' is the merged index
+                Graph::OrderType shift;
+            };
+
+            ComponentsView(std::vector<GraphPtr> components, bool shuffle);
+
+            Graph::Type type();
+            Graph::OrderType order();
+            Graph::SizeType size();
+            bool empty();
+            std::vector<GraphPtr>& components();
+            Graph::OrderType shift(size_t component_index);
+            size_t component_index(Graph::OrderType merged_vertex);
+
+            Row row(Graph::OrderType index);
+            // printed indices of the neighbors of the vertex at 'index', in adjacency order or ascending
+            // 'skip_smaller' drops neighbors with a smaller index, so every undirected edge is listed once
+            void row_labels(Graph::OrderType index, bool skip_smaller, bool sorted, std::vector<Graph::OrderType> &labels);
+            // printed index of a merged vertex and the other way round
+            Graph::OrderType label(Graph::OrderType merged_vertex);
+            Graph::OrderType vertex(Graph::OrderType index);
+
+            // merged (and never relabeled) copy for the debug printers
+            GraphPtr merge();
+
+        private:
+            std::vector<GraphPtr> components_;
+            std::vector<Graph::OrderType> shift_;
+            Graph::SizeType size_;
+            // both are empty when the vertices are not shuffled
+            std::vector<Graph::OrderType> label_;
+            std::vector<Graph::OrderType> vertex_;
+        };
+    }
+
+    class OutputTemplate;
+
     class GraphPrinter {
     public:
         struct OutputFormat {
@@ -14,6 +82,9 @@ namespace graph_constraint_solver {
                 kEdgeList,
                 kAdjMatrix,
                 kParentArray,
+                kBinaryEdgeList,
+                kBinaryCSR,
+                kBinaryAdjMatrix,
             };
 
             enum class Indexation {
@@ -21,29 +92,160 @@ namespace graph_constraint_solver {
                 kOneBased,
             };
 
+            enum class Compression {
+                kNone,
+                kGzip,
+            };
+
             using Filepath = std::string;
+            // number of part files an edge list is split into, 1 means a single ordinary output
+            using Shards = size_t;
+            // parent-array root, given in zero-based indexation
+            using Root = Graph::OrderType;
 
             static const Structure kDefaultStructure = Structure::kEdgeList;
             static const Indexation kDefaultIndexation = Indexation::kOneBased;
+            static const Compression kDefaultCompression = Compression::kNone;
             static const Filepath kDefaultFilepath;
+            static const Root kRandomRoot = -1;
+            static const Shards kMaximumShards = 4096;
 
             Structure structure;
             Indexation indexation;
             Filepath filepath;
+            bool debug;
+            Root root;
+            Compression compression;
+            // vertices are relabeled by a random permutation while printing
+            bool shuffle;
+            // edges are listed by ascending (from, to), undirected ones with from <= to
+            bool sorted;
+            Shards shards;
+            // text edge-list layout, the default "order size" header and "u v" lines when null
+            std::shared_ptr<const OutputTemplate> layout;
+            // the output is appended to 'filepath' as a new container entry (see container.h)
+            bool container;
+            // every written file is hashed while it's written and recorded here, not set by the constructor
+            ManifestPtr manifest;
 
             OutputFormat(Structure structure = kDefaultStructure,
                     Indexation indexation = kDefaultIndexation,
-                    Filepath filepath = kDefaultFilepath);
+                    Filepath filepath = kDefaultFilepath,
+                    bool debug = false,
+                    Root root = kRandomRoot,
+                    Compression compression = kDefaultCompression,
+                    bool shuffle = false,
+                    bool sorted = false,
+                    Shards shards = 1,
+                    std::shared_ptr<const OutputTemplate> layout = nullptr,
+                    bool container = false);
         };
 
+        // binary structures start with 4 little-endian 64-bit fields: order, size, directed (0 or 1), index width
+        // all following numbers are little-endian and 'index width' (4 or 8) bytes wide
+        // packed matrices have index width 0, every row takes (order + 7) / 8 bytes, bit j of a row is (byte[j / 8] >> (j % 8)) & 1
+        static const size_t kBinaryHeaderFieldWidth = 8;
+        static const size_t kBinaryHeaderSize = 4 * kBinaryHeaderFieldWidth;
+
+        // sharded edge lists are written to 'filepath.000', 'filepath.001', ... (one thread per shard)
+        // every shard holds the edges of a contiguous range of vertices without any header,
+        // 'filepath.manifest' is a JSON object with order, size, directed, indexation, index width (binary only)
+        // and the list of shard files with their edge counts
+        static OutputFormat::Filepath shard_filepath(const OutputFormat::Filepath &filepath, size_t shard, size_t shards);
+        static const char* const kManifestExtension;
+
         GraphPrinter(GraphPtr graph, OutputFormat &output_format, bool debug);
+        // disjoint components are printed one after another, as if they were merged into one graph
+        GraphPrinter(const std::vector<GraphPtr> &components, OutputFormat &output_format, bool debug);
+
+        // prints the same components into several outputs, generating and traversing them only once per output
+        // outputs to files are written concurrently, debug and standard output ones follow one by one in the given order
+        // all shuffled outputs share one relabeling and random parent-array roots are chosen once for all outputs
+        static void print_all(const std::vector<GraphPtr> &components, std::vector<OutputFormat> output_formats,
+                bool debug);
+
+        // streaming mode: edges added to edge_list_sink() are printed right away as a text edge list
+        // in the order they are added, close() must be called after the sink's end()
+        explicit GraphPrinter(OutputFormat &output_format);
+        EdgeSink& edge_list_sink();
+        void close();
+
+        // approximate number of adjacency entries formatted by one task
+        static const size_t kChunkAdjacencySize = 1 << 16;
+
+        // size of the buffer the streaming sink accumulates before writing it out
+        static const size_t kStreamBufferSize = 1 << 20;
 
     private:
-        std::ofstream output_file_;
-        std::ostream& output();
+        class EdgeListSink : public EdgeSink {
+        public:
+            EdgeListSink(GraphPrinter &printer, OutputFormat &output_format);
+            void begin(Graph::Type type, Graph::OrderType order, Graph::SizeType size) override;
+            void end() override;
+
+        protected:
+            void consume_edge(Graph::OrderType from, Graph::OrderType to) override;
+
+        private:
+            GraphPrinter &printer_;
+            size_t add_to_index_;
+            bool shuffle_;
+            std::vector<Graph::OrderType> label_;
+            impl::TextBuffer buffer_;
+        };
+
+        GraphPrinter(impl::ComponentsView &graph, OutputFormat &output_format, bool debug);
+        void open(OutputFormat &output_format);
+        // when 'hashing' is given, the bytes reaching the file are also hashed by a stream stored there
+        static OutputStreamPtr open_stream(const OutputFormat::Filepath &filepath, OutputFormat::Compression compression,
+                bool container = false, HashingOutputStream **hashing = nullptr);
+        // closes the output and records it in the manifest
+        void close_stream();
+        void print(impl::ComponentsView &graph, OutputFormat &output_format, bool debug);
+        std::unique_ptr<EdgeListSink> edge_list_sink_;
+
+        OutputStreamPtr output_stream_;
+        std::shared_ptr<const OutputTemplate> layout_;
+        ManifestPtr manifest_;
+        OutputFormat::Filepath filepath_;
+        HashingOutputStream *hashing_ = nullptr;
+        Graph::OrderType printed_order_ = 0;
+        Graph::SizeType printed_size_ = 0;
+        void write(impl::TextBuffer &buffer);
+        void print_line(std::initializer_list<long long> numbers);
+
+        // formats vertices [first, last) into the buffer
+        // 'scratch' belongs to the buffer's slot and keeps its contents between the chunks formatted into it
+        using ChunkFormatter = std::function<void(Graph::OrderType first, Graph::OrderType last, impl::TextBuffer &buffer,
+                std::string &scratch)>;
+        // splits vertices into chunks, formats them in parallel and writes the result in the original order
+        // chunk size is measured in adjacency entries plus 'vertex_cost' per vertex
+        void print_chunks(impl::ComponentsView &graph, ChunkFormatter formatter, size_t vertex_cost = 1);
+
+        // text or binary edge-list lines of vertices [first, last), returns the number of edges
+        Graph::SizeType format_edges(impl::ComponentsView &graph, OutputFormat &output_format, size_t index_width,
+                Graph::OrderType first, Graph::OrderType last, impl::TextBuffer &buffer);
+
+        // text edge list, format_edges writes an undirected edge once and a directed one as it is
+        void print_edge_list(impl::ComponentsView &graph, OutputFormat &output_format);
+
+        size_t binary_index_width(impl::ComponentsView &graph, size_t add_to_index);
+        // 'payload_size' is the number of bytes that follow the header, the output may preallocate them
+        void print_binary_header(impl::ComponentsView &graph, size_t index_width, unsigned long long payload_size);
+        // 'size' pairs (from, to), each undirected edge is written once
+        void print_binary_edge_list(impl::ComponentsView &graph, OutputFormat &output_format);
+        void print_sharded_edge_list(impl::ComponentsView &graph, OutputFormat &output_format);
+        // 'order + 1' offsets into the targets array, then the targets of every vertex
+        // undirected edges are stored in both directions, offsets are always zero-based
+        void print_binary_csr(impl::ComponentsView &graph, OutputFormat &output_format);
+
+        // matrices are built one row at a time, memory usage is O(order) per formatting thread
+        void print_adjacency_matrix(impl::ComponentsView &graph);
+        void print_binary_adjacency_matrix(impl::ComponentsView &graph);
 
-        void print_undirected(GraphPtr graph, OutputFormat &output_format);
-        void print_directed(GraphPtr graph, OutputFormat &ouptut_format);
+        // order, then parents of all vertices, roots have parent 0 (one-based) or -1 (zero-based)
+        // only undirected forests can be printed this way
+        void print_parent_array(impl::ComponentsView &graph, OutputFormat &output_format);
 
         void print_undirected_debug(GraphPtr graph, OutputFormat &output_format);
         void print_directed_debug(GraphPtr graph, OutputFormat &ouptut_format);
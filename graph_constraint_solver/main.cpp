@@ -11,6 +11,7 @@
 #include "generator.h"
 #include "graph_algorithms.h"
 #include "program.h"
+#include "container.h"
 
 int main(int argc, char *argv[]) {
 
@@ -18,6 +19,27 @@ int main(int argc, char *argv[]) {
         throw std::runtime_error("graph_constraint_solver error: too few arguments");
     }
 
+    // graph_constraint_solver --extract <container> [entry]: lists the entries or prints one of them to stdout
+    if (std::string(argv[1]) == "--extract") {
+        graph_constraint_solver::ContainerReader reader(argv[2]);
+        if (argc == 3) {
+            for (size_t i = 0; i < reader.size(); ++i) {
+                auto &entry = reader.entry(i);
+                std::cout << i << " " << entry.offset << " " << entry.length << " " << entry.seed << "\n";
+            }
+            return 0;
+        }
+        size_t index;
+        try {
+            index = std::stoull(argv[3]);
+        }
+        catch (...) {
+            throw std::runtime_error("graph_constraint_solver error: expected container entry number");
+        }
+        reader.extract(index, std::cout);
+        return 0;
+    }
+
     try {
         auto random_sid = std::stoll(argv[1]);
         graph_constraint_solver::random.set_seed(random_sid);
@@ -42,7 +64,7 @@ int main(int argc, char *argv[]) {
     graph_constraint_solver::InputBlock::Arguments arguments(argv + 3, argv + argc);
 
     // TODO: pass output stream (now just output to stdout)
-    graph_constraint_solver::Program program(json_file, arguments);
+    graph_constraint_solver::Program program(json_file, arguments, argv[2]);
     return 0;
 
 //    std::pair<int, int> order = {std::stoi(argv[2]), std::stoi(argv[3])};
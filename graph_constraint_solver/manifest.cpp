@@ -0,0 +1,59 @@
+#include "manifest.h"
+
+#include <stdexcept>
+#include <cerrno>
+#include <cstring>
+#include <nlohmann/json.hpp>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "utils.h"
+
+namespace graph_constraint_solver {
+
+    Manifest::Manifest(std::string filepath, std::string program_file, std::vector<std::string> arguments)
+        : filepath_(std::move(filepath)), program_file_(std::move(program_file)), arguments_(std::move(arguments)) {
+
+    }
+
+    const std::string& Manifest::filepath() const {
+        return filepath_;
+    }
+
+    std::string Manifest::hash_to_string(unsigned long long hash) {
+        static const char kDigits[] = "0123456789abcdef";
+        std::string text(16, '0');
+        for (size_t i = 16; i-- > 0; hash >>= 4) {
+            text[i] = kDigits[hash & 0xf];
+        }
+        return text;
+    }
+
+    void Manifest::append(const std::string &output, Graph::OrderType order, Graph::SizeType size,
+            unsigned long long bytes, unsigned long long hash) {
+
+        nlohmann::json entry;
+        entry["file"] = output.empty() ? "stdout" : output;
+        entry["seed"] = random.seed();
+        entry["program"] = program_file_;
+        entry["arguments"] = arguments_;
+        entry["order"] = order;
+        entry["size"] = size;
+        entry["bytes"] = bytes;
+        entry["xxh64"] = hash_to_string(hash);
+        auto line = entry.dump() + "\n";
+
+        auto fd = ::open(filepath_.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+        if (fd == -1) {
+            throw std::runtime_error("Manifest error: can't open " + filepath_ + ": " + std::strerror(errno));
+        }
+        auto written = ::write(fd, line.data(), line.size());
+        auto error = errno;
+        ::close(fd);
+        if (written != static_cast<ssize_t>(line.size())) {
+            throw std::runtime_error("Manifest error: can't write " + filepath_ + ": " +
+                    (written < 0 ? std::strerror(error) : "short write"));
+        }
+    }
+}
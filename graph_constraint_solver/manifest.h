@@ -0,0 +1,40 @@
+#ifndef GRAPH_CONSTRAINT_SOLVER_MANIFEST_H
+#define GRAPH_CONSTRAINT_SOLVER_MANIFEST_H
+
+#include <string>
+#include <vector>
+
+#include "graph.h"
+
+namespace graph_constraint_solver {
+
+    // JSON-lines file describing generated outputs, one line per written file:
+    // {"file", "seed", "program", "arguments", "order", "size", "bytes", "xxh64"}
+    // lines are appended with a single write, so several runs may share one manifest
+    class Manifest {
+    public:
+        Manifest(std::string filepath, std::string program_file, std::vector<std::string> arguments);
+
+        // 'output' is the printed file path, empty for the standard output
+        void append(const std::string &output, Graph::OrderType order, Graph::SizeType size,
+                unsigned long long bytes, unsigned long long hash);
+
+        const std::string& filepath() const;
+
+        // hash as printed by 'xxhsum -H64'
+        static std::string hash_to_string(unsigned long long hash);
+
+    private:
+        std::string filepath_;
+        std::string program_file_;
+        std::vector<std::string> arguments_;
+    };
+
+    using ManifestPtr = std::shared_ptr<Manifest>;
+}
+
+#ifdef GRAPH_CONSTRAINT_SOLVER_SINGLE_HEADER
+#include "manifest.cpp"
+#endif
+
+#endif //GRAPH_CONSTRAINT_SOLVER_MANIFEST_H
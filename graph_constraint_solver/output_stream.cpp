@@ -0,0 +1,534 @@
+#include "output_stream.h"
+
+#include <stdexcept>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <cstdlib>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#ifdef __linux__
+#include <sys/uio.h>
+#endif
+
+#ifdef GRAPH_CONSTRAINT_SOLVER_ZLIB
+#include <zlib.h>
+#endif
+
+namespace graph_constraint_solver {
+
+    namespace impl {
+        // ring of the standard output while it's spliced into a pipe: the pipe may still reference the pages
+        // of the last spliced buffer after a stream is closed, so the storage is never freed and the next stream
+        // on the standard output continues right after that buffer
+        struct SplicedRing {
+            std::mutex mutex;
+            char *storage = nullptr;
+            long long last_spliced = -1;
+            // a failed stream may leave any of the buffers referenced
+            bool usable = true;
+        };
+
+        SplicedRing& standard_output_ring() {
+            static SplicedRing ring;
+            return ring;
+        }
+
+        std::runtime_error errno_error(const std::string &prefix) {
+            return std::runtime_error(prefix + ": " + std::strerror(errno));
+        }
+    } //impl
+
+    // FileOutputStream
+
+    FileOutputStream::FileOutputStream(const std::string &filepath)
+        : fd_(STDOUT_FILENO), owns_fd_(false), positional_(false), offset_(0), written_(0), reserved_(0),
+        splice_(false), last_spliced_(-1), storage_(nullptr, std::free), buffer_size_(kBufferCount), head_(0), tail_(0),
+        closed_(false), failed_(false) {
+
+        if (!filepath.empty()) {
+            fd_ = ::open(filepath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            if (fd_ == -1) {
+                throw impl::errno_error("Can't open file " + filepath);
+            }
+            owns_fd_ = true;
+            // fifos and devices (e.g. /dev/stdout) can't seek, they are written like the standard output
+            struct stat status;
+            if (fstat(fd_, &status) == 0 && S_ISREG(status.st_mode)) {
+                positional_ = true;
+#ifdef __linux__
+                posix_fadvise(fd_, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+            }
+        }
+        else {
+            // whatever was printed to std::cout before must come first
+            std::cout.flush();
+            setup_splice();
+        }
+        start();
+    }
+
+    FileOutputStream::FileOutputStream(int fd, unsigned long long offset)
+        : fd_(fd), owns_fd_(false), positional_(true), offset_(offset), written_(offset), reserved_(0),
+        splice_(false), last_spliced_(-1), storage_(nullptr, std::free), buffer_size_(kBufferCount), head_(0), tail_(0),
+        closed_(false), failed_(false) {
+
+        start();
+    }
+
+    void FileOutputStream::start() {
+        if (!storage_) {
+            storage_.reset(allocate_ring());
+        }
+        // the producer may submit buffers before the thread starts, so the first index is passed to it
+        thread_ = std::thread(&FileOutputStream::write_buffers, this, tail_.load(std::memory_order_relaxed));
+    }
+
+    char* FileOutputStream::allocate_ring() {
+        // kBufferSize is a multiple of the page size, so every buffer is page-aligned
+        void *storage = nullptr;
+        if (posix_memalign(&storage, sysconf(_SC_PAGESIZE), kBufferCount * kBufferSize) != 0) {
+            throw std::bad_alloc();
+        }
+        return static_cast<char*>(storage);
+    }
+
+    FileOutputStream::~FileOutputStream() {
+        finish_thread();
+        if (owns_fd_) {
+            ::close(fd_);
+        }
+    }
+
+    char* FileOutputStream::buffer(size_t index) {
+        return storage_.get() + index % kBufferCount * kBufferSize;
+    }
+
+    void FileOutputStream::write(const char *data, size_t length) {
+        written_ += length;
+        while (length) {
+            auto tail = tail_.load(std::memory_order_relaxed);
+            auto &size = buffer_size_[tail % kBufferCount];
+            auto part = std::min(length, kBufferSize - size);
+            std::memcpy(buffer(tail) + size, data, part);
+            size += part;
+            data += part;
+            length -= part;
+            if (size == kBufferSize) {
+                submit_buffer();
+            }
+        }
+    }
+
+    void FileOutputStream::reserve(size_t length) {
+#ifdef __linux__
+        if (!positional_ || length == 0) return;
+        if (posix_fallocate(fd_, 0, written_ + length) == 0) {
+            reserved_ = written_ + length;
+        }
+#endif
+    }
+
+    void FileOutputStream::close() {
+        if (buffer_size_[tail_.load(std::memory_order_relaxed) % kBufferCount]) {
+            submit_buffer();
+        }
+        finish_thread();
+        if (exception_) {
+            std::rethrow_exception(exception_);
+        }
+        // preallocated space that was not used must not stay in the file
+        if (reserved_ > offset_ && ftruncate(fd_, offset_) != 0) {
+            throw impl::errno_error("FileOutputStream error: ftruncate failed");
+        }
+        if (owns_fd_) {
+            owns_fd_ = false;
+            if (::close(fd_) != 0) {
+                throw impl::errno_error("FileOutputStream error: close failed");
+            }
+        }
+    }
+
+    void FileOutputStream::submit_buffer() {
+        tail_.fetch_add(1, std::memory_order_release);
+        notify();
+        wait_for_free_buffer();
+        buffer_size_[tail_.load(std::memory_order_relaxed) % kBufferCount] = 0;
+    }
+
+    void FileOutputStream::wait_for_free_buffer() {
+        wait_for([&]() {
+            return tail_.load(std::memory_order_relaxed) - head_.load(std::memory_order_acquire) < kBufferCount ||
+                    failed_.load(std::memory_order_acquire);
+        });
+        if (failed_.load(std::memory_order_acquire)) {
+            std::rethrow_exception(exception_);
+        }
+    }
+
+    // the other side spins for a moment, then blocks until notify()
+    void FileOutputStream::wait_for(const std::function<bool()> &ready) {
+        const size_t kSpinAttempts = 64;
+        for (size_t attempt = 0; attempt < kSpinAttempts; ++attempt) {
+            if (ready()) return;
+        }
+        std::unique_lock<std::mutex> lock(mutex_);
+        changed_.wait(lock, ready);
+    }
+
+    void FileOutputStream::notify() {
+        // the empty critical section orders the change before the predicate check of a waiter that is about to block
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+        }
+        changed_.notify_all();
+    }
+
+    void FileOutputStream::finish_thread() {
+        closed_.store(true, std::memory_order_release);
+        notify();
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+        if (ring_lock_.owns_lock()) {
+            auto &ring = impl::standard_output_ring();
+            ring.last_spliced = last_spliced_;
+            ring.usable = !failed_.load(std::memory_order_acquire);
+            ring_lock_.unlock();
+        }
+    }
+
+    void FileOutputStream::write_buffers(size_t next) {
+        try {
+            while (true) {
+                wait_for([&]() {
+                    return next != tail_.load(std::memory_order_acquire) || closed_.load(std::memory_order_acquire);
+                });
+                // 'closed_' is set after the last submit, so the tail has to be checked once more
+                if (next == tail_.load(std::memory_order_acquire)) {
+                    break;
+                }
+                // pages given with vmsplice stay referenced by the pipe until the reader consumes them;
+                // only full buffers are spliced, a full buffer outsizes the pipe, so once it's spliced completely
+                // no earlier page is left in the pipe; the last, partial buffer is copied and never stays referenced
+                auto size = buffer_size_[next % kBufferCount];
+                if (splice_ && size == kBufferSize) {
+                    splice_fully(buffer(next), size);
+                    last_spliced_ = static_cast<long long>(next);
+                }
+                else {
+                    write_fully(buffer(next), size);
+                }
+                ++next;
+                head_.store(last_spliced_ != -1 ? static_cast<size_t>(last_spliced_) : next, std::memory_order_release);
+                notify();
+            }
+        }
+        catch (...) {
+            exception_ = std::current_exception();
+            failed_.store(true, std::memory_order_release);
+            notify();
+        }
+    }
+
+    void FileOutputStream::write_fully(const char *data, size_t length) {
+        while (length) {
+            auto written = positional_ ? ::pwrite(fd_, data, length, offset_) : ::write(fd_, data, length);
+            if (written < 0) {
+                if (errno == EINTR) continue;
+                throw impl::errno_error("FileOutputStream error: write failed");
+            }
+            data += written;
+            length -= written;
+            offset_ += written;
+        }
+    }
+
+    void FileOutputStream::setup_splice() {
+#ifdef __linux__
+        struct stat status;
+        if (fstat(fd_, &status) != 0 || !S_ISFIFO(status.st_mode)) {
+            return;
+        }
+        // the pipe is left the size the caller made it, vmsplice is only used if it doesn't outsize a buffer
+        auto pipe_size = fcntl(fd_, F_GETPIPE_SZ);
+        if (pipe_size <= 0 || static_cast<size_t>(pipe_size) > kBufferSize) {
+            return;
+        }
+        // another stream on the standard output (or a failed one) leaves this one to plain writes
+        auto &ring = impl::standard_output_ring();
+        ring_lock_ = std::unique_lock<std::mutex>(ring.mutex, std::try_to_lock);
+        if (!ring_lock_.owns_lock()) {
+            return;
+        }
+        if (!ring.usable) {
+            ring_lock_.unlock();
+            return;
+        }
+        if (!ring.storage) {
+            ring.storage = allocate_ring();
+        }
+        storage_ = std::unique_ptr<char, void(*)(void*)>(ring.storage, [](void*) {});
+        splice_ = true;
+        // the last spliced buffer stays in use until a full buffer is spliced after it
+        last_spliced_ = ring.last_spliced;
+        if (last_spliced_ != -1) {
+            head_.store(static_cast<size_t>(last_spliced_), std::memory_order_relaxed);
+            tail_.store(static_cast<size_t>(last_spliced_) + 1, std::memory_order_relaxed);
+        }
+#endif
+    }
+
+    void FileOutputStream::splice_fully(const char *data, size_t length) {
+#ifdef __linux__
+        while (length) {
+            iovec vector{const_cast<char*>(data), length};
+            auto written = vmsplice(fd_, &vector, 1, 0);
+            if (written < 0) {
+                if (errno == EINTR) continue;
+                // e.g. a kernel without vmsplice support, the rest goes through write
+                if (errno == EINVAL || errno == ENOSYS) {
+                    write_fully(data, length);
+                    return;
+                }
+                throw impl::errno_error("FileOutputStream error: vmsplice failed");
+            }
+            data += written;
+            length -= written;
+            offset_ += written;
+        }
+#else
+        write_fully(data, length);
+#endif
+    }
+
+    // HashingOutputStream
+
+    namespace impl {
+        const unsigned long long kXXPrime1 = 0x9E3779B185EBCA87ULL;
+        const unsigned long long kXXPrime2 = 0xC2B2AE3D27D4EB4FULL;
+        const unsigned long long kXXPrime3 = 0x165667B19E3779F9ULL;
+        const unsigned long long kXXPrime4 = 0x85EBCA77C2B2AE63ULL;
+        const unsigned long long kXXPrime5 = 0x27D4EB2F165667C5ULL;
+
+        unsigned long long rotate_left(unsigned long long value, int bits) {
+            return (value << bits) | (value >> (64 - bits));
+        }
+
+        unsigned long long load_little_endian(const char *data, size_t width) {
+            unsigned long long value = 0;
+            for (size_t i = 0; i < width; ++i) {
+                value |= static_cast<unsigned long long>(static_cast<unsigned char>(data[i])) << (8 * i);
+            }
+            return value;
+        }
+
+        unsigned long long xx_round(unsigned long long accumulator, unsigned long long lane) {
+            accumulator += lane * kXXPrime2;
+            return rotate_left(accumulator, 31) * kXXPrime1;
+        }
+
+        unsigned long long xx_merge_round(unsigned long long hash, unsigned long long accumulator) {
+            hash ^= xx_round(0, accumulator);
+            return hash * kXXPrime1 + kXXPrime4;
+        }
+    } //impl
+
+    HashingOutputStream::HashingOutputStream(OutputStreamPtr output)
+        : output_(std::move(output)),
+        accumulator_{impl::kXXPrime1 + impl::kXXPrime2, impl::kXXPrime2, 0, 0ULL - impl::kXXPrime1},
+        stripe_size_(0), length_(0) {
+
+    }
+
+    void HashingOutputStream::consume_stripe(const char *data) {
+        for (size_t lane = 0; lane < 4; ++lane) {
+            accumulator_[lane] = impl::xx_round(accumulator_[lane], impl::load_little_endian(data + 8 * lane, 8));
+        }
+    }
+
+    void HashingOutputStream::write(const char *data, size_t length) {
+        output_->write(data, length);
+        length_ += length;
+        if (stripe_size_) {
+            auto part = std::min(length, kStripeSize - stripe_size_);
+            std::memcpy(stripe_ + stripe_size_, data, part);
+            stripe_size_ += part;
+            data += part;
+            length -= part;
+            if (stripe_size_ < kStripeSize) return;
+            consume_stripe(stripe_);
+            stripe_size_ = 0;
+        }
+        for (; length >= kStripeSize; data += kStripeSize, length -= kStripeSize) {
+            consume_stripe(data);
+        }
+        std::memcpy(stripe_, data, length);
+        stripe_size_ = length;
+    }
+
+    void HashingOutputStream::reserve(size_t length) {
+        output_->reserve(length);
+    }
+
+    void HashingOutputStream::close() {
+        output_->close();
+    }
+
+    unsigned long long HashingOutputStream::length() {
+        return length_;
+    }
+
+    unsigned long long HashingOutputStream::digest() {
+        unsigned long long hash;
+        if (length_ >= kStripeSize) {
+            hash = impl::rotate_left(accumulator_[0], 1) + impl::rotate_left(accumulator_[1], 7) +
+                    impl::rotate_left(accumulator_[2], 12) + impl::rotate_left(accumulator_[3], 18);
+            for (auto accumulator : accumulator_) {
+                hash = impl::xx_merge_round(hash, accumulator);
+            }
+        }
+        else {
+            hash = impl::kXXPrime5;
+        }
+        hash += length_;
+
+        const char *data = stripe_;
+        size_t length = stripe_size_;
+        for (; length >= 8; data += 8, length -= 8) {
+            hash ^= impl::xx_round(0, impl::load_little_endian(data, 8));
+            hash = impl::rotate_left(hash, 27) * impl::kXXPrime1 + impl::kXXPrime4;
+        }
+        if (length >= 4) {
+            hash ^= impl::load_little_endian(data, 4) * impl::kXXPrime1;
+            hash = impl::rotate_left(hash, 23) * impl::kXXPrime2 + impl::kXXPrime3;
+            data += 4;
+            length -= 4;
+        }
+        for (; length; ++data, --length) {
+            hash ^= static_cast<unsigned char>(*data) * impl::kXXPrime5;
+            hash = impl::rotate_left(hash, 11) * impl::kXXPrime1;
+        }
+
+        hash ^= hash >> 33;
+        hash *= impl::kXXPrime2;
+        hash ^= hash >> 29;
+        hash *= impl::kXXPrime3;
+        hash ^= hash >> 32;
+        return hash;
+    }
+
+    // GzipOutputStream
+
+    GzipOutputStream::GzipOutputStream(OutputStreamPtr output, int level)
+        : output_(std::move(output)), level_(level), closed_(false) {
+
+#ifndef GRAPH_CONSTRAINT_SOLVER_ZLIB
+        throw std::runtime_error("GzipOutputStream error: compiled without zlib support");
+#endif
+        thread_ = std::thread(&GzipOutputStream::compress, this);
+    }
+
+    GzipOutputStream::~GzipOutputStream() {
+        finish_thread();
+    }
+
+    void GzipOutputStream::write(const char *data, size_t length) {
+        if (length == 0) return;
+        std::unique_lock<std::mutex> lock(mutex_);
+        pending_changed_.wait(lock, [&]() {
+            return pending_.size() < kMaximumPendingBuffers || exception_;
+        });
+        if (exception_) {
+            std::rethrow_exception(exception_);
+        }
+        pending_.emplace_back(data, length);
+        pending_changed_.notify_all();
+    }
+
+    void GzipOutputStream::close() {
+        finish_thread();
+        if (exception_) {
+            std::rethrow_exception(exception_);
+        }
+        output_->close();
+    }
+
+    void GzipOutputStream::finish_thread() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            closed_ = true;
+        }
+        pending_changed_.notify_all();
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+    }
+
+    void GzipOutputStream::compress() {
+#ifdef GRAPH_CONSTRAINT_SOLVER_ZLIB
+        const size_t kOutputBufferSize = 1 << 18;
+        // 15 window bits + 16 means gzip header and trailer instead of zlib ones
+        const int kGzipWindowBits = 15 + 16;
+        const int kMemoryLevel = 8;
+
+        z_stream stream{};
+        if (deflateInit2(&stream, level_, Z_DEFLATED, kGzipWindowBits, kMemoryLevel, Z_DEFAULT_STRATEGY) != Z_OK) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            exception_ = std::make_exception_ptr(std::runtime_error("GzipOutputStream error: deflateInit failed"));
+            pending_changed_.notify_all();
+            return;
+        }
+
+        std::string output_buffer(kOutputBufferSize, 0);
+        auto deflate_buffer = [&](std::string &input, int flush) {
+            stream.next_in = reinterpret_cast<Bytef*>(&input[0]);
+            stream.avail_in = static_cast<uInt>(input.size());
+            do {
+                stream.next_out = reinterpret_cast<Bytef*>(&output_buffer[0]);
+                stream.avail_out = static_cast<uInt>(output_buffer.size());
+                if (deflate(&stream, flush) == Z_STREAM_ERROR) {
+                    throw std::runtime_error("GzipOutputStream error: deflate failed");
+                }
+                output_->write(output_buffer.data(), output_buffer.size() - stream.avail_out);
+            } while (stream.avail_out == 0);
+        };
+
+        try {
+            while (true) {
+                std::string input;
+                bool last;
+                {
+                    std::unique_lock<std::mutex> lock(mutex_);
+                    pending_changed_.wait(lock, [&]() {
+                        return !pending_.empty() || closed_;
+                    });
+                    if (pending_.empty()) {
+                        break;
+                    }
+                    input.swap(pending_.front());
+                    pending_.pop_front();
+                    last = closed_ && pending_.empty();
+                }
+                pending_changed_.notify_all();
+                deflate_buffer(input, Z_NO_FLUSH);
+                if (last) {
+                    break;
+                }
+            }
+            std::string empty;
+            deflate_buffer(empty, Z_FINISH);
+        }
+        catch (...) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            exception_ = std::current_exception();
+            pending_changed_.notify_all();
+        }
+        deflateEnd(&stream);
+#endif
+    }
+}
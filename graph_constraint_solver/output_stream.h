@@ -0,0 +1,152 @@
+#ifndef GRAPH_CONSTRAINT_SOLVER_OUTPUT_STREAM_H
+#define GRAPH_CONSTRAINT_SOLVER_OUTPUT_STREAM_H
+
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include <deque>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+
+namespace graph_constraint_solver {
+
+    // byte sink used by GraphPrinter, streams can be chained (e.g. compression -> file)
+    class OutputStream {
+    public:
+        virtual ~OutputStream() = default;
+        virtual void write(const char *data, size_t length) = 0;
+        // hint: exactly that many more bytes are going to be written, streams may preallocate space for them
+        virtual void reserve(size_t) {}
+        // flushes everything written so far, no writes are allowed after it
+        virtual void close() = 0;
+    };
+
+    using OutputStreamPtr = std::unique_ptr<OutputStream>;
+
+    // writes to a file (or to the standard output if the path is empty) from a dedicated thread:
+    // filled buffers are handed over through a single-producer single-consumer ring,
+    // so generation and formatting overlap with the write syscalls; an idle side blocks until the other one
+    // hands over or frees a buffer
+    // on Linux, when the standard output is a pipe, full page-aligned buffers are handed to the kernel with vmsplice
+    // instead of being copied by write
+    class FileOutputStream : public OutputStream {
+    public:
+        static const size_t kBufferSize = 1 << 20;
+        static const size_t kBufferCount = 4;
+
+        explicit FileOutputStream(const std::string &filepath);
+        // writes to an already open regular file starting at 'offset', the descriptor is not closed by the stream
+        FileOutputStream(int fd, unsigned long long offset);
+        ~FileOutputStream() override;
+        void write(const char *data, size_t length) override;
+        void reserve(size_t length) override;
+        void close() override;
+
+    private:
+        void start();
+        static char* allocate_ring();
+        void submit_buffer();
+        void wait_for_free_buffer();
+        void wait_for(const std::function<bool()> &ready);
+        void notify();
+        void write_buffers(size_t next);
+        void write_fully(const char *data, size_t length);
+        void setup_splice();
+        void splice_fully(const char *data, size_t length);
+        void finish_thread();
+
+        char* buffer(size_t index);
+
+        int fd_;
+        bool owns_fd_;
+        // regular files opened by the stream are written with pwrite at a tracked offset
+        bool positional_;
+        // 'offset_' is advanced by the writer thread, 'written_' by the producer
+        unsigned long long offset_;
+        unsigned long long written_;
+        unsigned long long reserved_;
+        // set when the standard output is a pipe whose capacity doesn't exceed kBufferSize,
+        // the stream then uses the process-wide ring of the standard output and holds its lock
+        bool splice_;
+        std::unique_lock<std::mutex> ring_lock_;
+        // index of the last buffer given to vmsplice, -1 if none
+        long long last_spliced_;
+
+        // buffers [head_, tail_) are filled and wait for the writer (or are still referenced by the pipe),
+        // buffer tail_ is being filled
+        std::unique_ptr<char, void(*)(void*)> storage_;
+        std::vector<size_t> buffer_size_;
+        std::atomic<size_t> head_;
+        std::atomic<size_t> tail_;
+        std::atomic<bool> closed_;
+        std::atomic<bool> failed_;
+        std::exception_ptr exception_;
+        // a side that has nothing to do blocks on 'changed_', every change of the ring's state notifies it
+        std::mutex mutex_;
+        std::condition_variable changed_;
+        std::thread thread_;
+    };
+
+    // passes the data through and computes its XXH64 hash (seed 0) in the same pass,
+    // digest() is the value printed by 'xxhsum -H64'
+    class HashingOutputStream : public OutputStream {
+    public:
+        explicit HashingOutputStream(OutputStreamPtr output);
+        void write(const char *data, size_t length) override;
+        void reserve(size_t length) override;
+        void close() override;
+
+        // both are final after close()
+        unsigned long long length();
+        unsigned long long digest();
+
+    private:
+        static const size_t kStripeSize = 32;
+
+        void consume_stripe(const char *data);
+
+        OutputStreamPtr output_;
+        unsigned long long accumulator_[4];
+        // tail of the data that doesn't fill a whole stripe yet
+        char stripe_[kStripeSize];
+        size_t stripe_size_;
+        unsigned long long length_;
+    };
+
+    // gzip-compresses the data on a background thread, so compression overlaps with formatting
+    // requires zlib (GRAPH_CONSTRAINT_SOLVER_ZLIB), otherwise the constructor throws
+    class GzipOutputStream : public OutputStream {
+    public:
+        // number of written but not yet compressed buffers, writers wait when it's exceeded
+        static const size_t kMaximumPendingBuffers = 8;
+
+        GzipOutputStream(OutputStreamPtr output, int level = -1);
+        ~GzipOutputStream() override;
+        void write(const char *data, size_t length) override;
+        void close() override;
+
+    private:
+        void compress();
+        void finish_thread();
+
+        OutputStreamPtr output_;
+        int level_;
+        std::deque<std::string> pending_;
+        bool closed_;
+        std::exception_ptr exception_;
+        std::mutex mutex_;
+        std::condition_variable pending_changed_;
+        std::thread thread_;
+    };
+}
+
+#ifdef GRAPH_CONSTRAINT_SOLVER_SINGLE_HEADER
+#include "output_stream.cpp"
+#endif
+
+#endif //GRAPH_CONSTRAINT_SOLVER_OUTPUT_STREAM_H
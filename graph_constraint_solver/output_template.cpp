@@ -0,0 +1,237 @@
+#include "output_template.h"
+
+#include <stdexcept>
+
+#include "utils.h"
+
+namespace graph_constraint_solver {
+
+    const std::string OutputTemplate::kDefaultHeader = "{order} {size}";
+    const std::string OutputTemplate::kDefaultEdge = "{u} {v}";
+
+    OutputTemplate::OutputTemplate(const std::string &header, const std::string &edge)
+        : header_(compile(header, false)), edge_(compile(edge, true)), edge_writer_(nullptr), texts_(1),
+        weight_min_(0), weight_max_(0), has_weights_(false), salted_(false), salt_(0) {
+
+        std::vector<Operation> fields;
+        for (auto &step : edge_) {
+            if (step.operation == Operation::kText) {
+                // compile() merges neighbouring texts, so a text always belongs to the last placeholder
+                texts_.back() = step.text;
+                continue;
+            }
+            fields.push_back(step.operation);
+            texts_.emplace_back();
+            if (step.operation == Operation::kWeight) {
+                has_weights_ = true;
+                weight_min_ = step.weight_min;
+                weight_max_ = step.weight_max;
+            }
+        }
+        edge_writer_ = select_edge_writer(fields);
+    }
+
+    OutputTemplate::EdgeWriter OutputTemplate::select_edge_writer(const std::vector<Operation> &fields) {
+        using Fields = std::vector<Operation>;
+        const auto u = Operation::kFrom;
+        const auto v = Operation::kTo;
+        const auto w = Operation::kWeight;
+        static const std::vector<std::pair<Fields, EdgeWriter>> kWriters = {
+                {{u, v}, &append_edge_fields<u, v>},
+                {{v, u}, &append_edge_fields<v, u>},
+                {{u, v, w}, &append_edge_fields<u, v, w>},
+                {{v, u, w}, &append_edge_fields<v, u, w>},
+                {{w, u, v}, &append_edge_fields<w, u, v>},
+                {{w, v, u}, &append_edge_fields<w, v, u>},
+                {{u, w, v}, &append_edge_fields<u, w, v>},
+                {{v, w, u}, &append_edge_fields<v, w, u>},
+        };
+        for (auto &[writer_fields, writer] : kWriters) {
+            if (writer_fields == fields) {
+                return writer;
+            }
+        }
+        return nullptr;
+    }
+
+    template<OutputTemplate::Operation... kFields>
+    void OutputTemplate::append_edge_fields(const OutputTemplate &layout, impl::TextBuffer &buffer, long long from,
+            long long to, long long add_to_index) {
+
+        size_t text = 0;
+        layout.append_text(buffer, text++);
+        ((layout.append_field<kFields>(buffer, from, to, add_to_index), layout.append_text(buffer, text++)), ...);
+    }
+
+    template<OutputTemplate::Operation kField>
+    void OutputTemplate::append_field(impl::TextBuffer &buffer, long long from, long long to,
+            long long add_to_index) const {
+
+        if constexpr (kField == Operation::kFrom) {
+            buffer.append_number(from + add_to_index);
+        }
+        else if constexpr (kField == Operation::kTo) {
+            buffer.append_number(to + add_to_index);
+        }
+        else {
+            buffer.append_number(weight(from, to, weight_min_, weight_max_));
+        }
+    }
+
+    void OutputTemplate::append_text(impl::TextBuffer &buffer, size_t index) const {
+        auto &text = texts_[index];
+        if (text.size() == 1) {
+            buffer.append(text[0]);
+        }
+        else if (!text.empty()) {
+            buffer.append(text.data(), text.size());
+        }
+    }
+
+    long long OutputTemplate::weight(long long from, long long to, long long weight_min, long long weight_max) const {
+        auto hash = impl::mix(salt_ ^ impl::mix(static_cast<unsigned long long>(from) << 32 ^
+                static_cast<unsigned long long>(to)));
+        auto range = static_cast<unsigned long long>(weight_max - weight_min) + 1;
+        // range is 0 only for the full 64-bit range
+        return weight_min + static_cast<long long>(range ? hash % range : hash);
+    }
+
+    std::vector<OutputTemplate::Step> OutputTemplate::compile(const std::string &pattern, bool edge) {
+        std::vector<Step> steps;
+        if (!edge && pattern.empty()) {
+            return steps;
+        }
+
+        auto add_text = [&](const std::string &text) {
+            if (!steps.empty() && steps.back().operation == Operation::kText) {
+                steps.back().text += text;
+            }
+            else {
+                steps.push_back(Step{Operation::kText, text, 0, 0});
+            }
+        };
+        auto bad = [&](const std::string &message) {
+            throw std::invalid_argument("OutputTemplate error: " + message + " in '" + pattern + "'");
+        };
+
+        for (size_t i = 0; i < pattern.size(); ++i) {
+            if (pattern.compare(i, 2, "{{") == 0 || pattern.compare(i, 2, "}}") == 0) {
+                add_text(std::string(1, pattern[i++]));
+                continue;
+            }
+            if (pattern[i] == '}') {
+                bad("unmatched '}'");
+            }
+            if (pattern[i] != '{') {
+                add_text(std::string(1, pattern[i]));
+                continue;
+            }
+
+            auto close = pattern.find('}', i);
+            if (close == std::string::npos) {
+                bad("unmatched '{'");
+            }
+            auto name = pattern.substr(i + 1, close - i - 1);
+            i = close;
+            if (name == "order" || name == "size") {
+                steps.push_back(Step{name == "order" ? Operation::kOrder : Operation::kSize, "", 0, 0});
+            }
+            else if (edge && (name == "u" || name == "v")) {
+                steps.push_back(Step{name == "u" ? Operation::kFrom : Operation::kTo, "", 0, 0});
+            }
+            else if (edge && name.compare(0, 7, "weight:") == 0) {
+                // {weight:min:max}
+                auto separator = name.find(':', 7);
+                if (separator == std::string::npos) {
+                    bad("expected {weight:min:max}");
+                }
+                long long weight_min, weight_max;
+                try {
+                    size_t min_length, max_length;
+                    weight_min = std::stoll(name.substr(7, separator - 7), &min_length);
+                    weight_max = std::stoll(name.substr(separator + 1), &max_length);
+                    if (min_length != separator - 7 || max_length != name.size() - separator - 1) {
+                        throw std::exception();
+                    }
+                }
+                catch (...) {
+                    bad("expected integer weight bounds");
+                }
+                if (weight_min > weight_max) {
+                    bad("empty weight range");
+                }
+                steps.push_back(Step{Operation::kWeight, "", weight_min, weight_max});
+            }
+            else {
+                bad("unknown placeholder '{" + name + "}'");
+            }
+        }
+        add_text("\n");
+        return steps;
+    }
+
+    bool OutputTemplate::has_header() const {
+        return !header_.empty();
+    }
+
+    void OutputTemplate::append_header(impl::TextBuffer &buffer, long long order, long long size) const {
+        for (auto &step : header_) {
+            switch (step.operation) {
+                case Operation::kText:
+                    buffer.append(step.text.data(), step.text.size());
+                    break;
+                case Operation::kOrder:
+                    buffer.append_number(order);
+                    break;
+                case Operation::kSize:
+                    buffer.append_number(size);
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+
+    void OutputTemplate::append_edge(impl::TextBuffer &buffer, long long from, long long to,
+            long long add_to_index) const {
+        if (edge_writer_) {
+            edge_writer_(*this, buffer, from, to, add_to_index);
+        }
+        else {
+            append_edge_steps(buffer, from, to, add_to_index);
+        }
+    }
+
+    void OutputTemplate::append_edge_steps(impl::TextBuffer &buffer, long long from, long long to,
+            long long add_to_index) const {
+        for (auto &step : edge_) {
+            switch (step.operation) {
+                case Operation::kText:
+                    buffer.append(step.text.data(), step.text.size());
+                    break;
+                case Operation::kFrom:
+                    buffer.append_number(from + add_to_index);
+                    break;
+                case Operation::kTo:
+                    buffer.append_number(to + add_to_index);
+                    break;
+                case Operation::kWeight:
+                    buffer.append_number(weight(from, to, step.weight_min, step.weight_max));
+                    break;
+                default:
+                    break;
+            }
+        }
+    }
+
+    bool OutputTemplate::needs_salt() const {
+        return has_weights_ && !salted_;
+    }
+
+    std::shared_ptr<const OutputTemplate> OutputTemplate::salted(unsigned long long salt) const {
+        auto result = std::make_shared<OutputTemplate>(*this);
+        result->salted_ = true;
+        result->salt_ = salt;
+        return result;
+    }
+}
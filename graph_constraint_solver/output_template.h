@@ -0,0 +1,90 @@
+#ifndef GRAPH_CONSTRAINT_SOLVER_OUTPUT_TEMPLATE_H
+#define GRAPH_CONSTRAINT_SOLVER_OUTPUT_TEMPLATE_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "graph_printer.h"
+
+namespace graph_constraint_solver {
+
+    // text layout of an edge list: a header line and a line per edge, e.g. header "{size} {order}"
+    // and edge "{u} {v} {weight:1:100}", '{{' and '}}' print a single brace, an empty header is not printed
+    // templates are compiled once into a list of steps, so printing an edge never parses the template again;
+    // edge layouts with {u} and {v} in any order and at most one {weight} get a writer specialized for the order
+    // of their placeholders, chosen once, the other layouts are printed by walking the steps
+    // weights are a hash of the edge and a per-output salt: reproducible for a seed and independent
+    // of how the output is split between threads, parallel edges get the same weight
+    class OutputTemplate {
+    public:
+        static const std::string kDefaultHeader;
+        static const std::string kDefaultEdge;
+
+        // throws std::invalid_argument on unknown placeholders or bad weight bounds
+        OutputTemplate(const std::string &header = kDefaultHeader, const std::string &edge = kDefaultEdge);
+
+        bool has_header() const;
+        void append_header(impl::TextBuffer &buffer, long long order, long long size) const;
+        // 'from' and 'to' are zero-based, 'add_to_index' is added to the printed indices only,
+        // so outputs of the same graph get the same weights whatever their indexation
+        void append_edge(impl::TextBuffer &buffer, long long from, long long to, long long add_to_index) const;
+
+        // templates with weights need a salt before printing, it's drawn from the global random by the printer
+        bool needs_salt() const;
+        std::shared_ptr<const OutputTemplate> salted(unsigned long long salt) const;
+
+    private:
+        enum class Operation {
+            kText,
+            kOrder,
+            kSize,
+            kFrom,
+            kTo,
+            kWeight,
+        };
+
+        struct Step {
+            Operation operation;
+            std::string text;
+            long long weight_min;
+            long long weight_max;
+        };
+
+        using EdgeWriter = void (*)(const OutputTemplate &layout, impl::TextBuffer &buffer, long long from,
+                long long to, long long add_to_index);
+
+        static std::vector<Step> compile(const std::string &pattern, bool edge);
+        // nullptr if the placeholders of the edge layout have no specialized writer
+        static EdgeWriter select_edge_writer(const std::vector<Operation> &fields);
+
+        // 'kFields' placeholders with texts_[0] before the first one and texts_[i] after the i-th one
+        template<Operation... kFields>
+        static void append_edge_fields(const OutputTemplate &layout, impl::TextBuffer &buffer, long long from,
+                long long to, long long add_to_index);
+        template<Operation kField>
+        void append_field(impl::TextBuffer &buffer, long long from, long long to, long long add_to_index) const;
+        void append_text(impl::TextBuffer &buffer, size_t index) const;
+        void append_edge_steps(impl::TextBuffer &buffer, long long from, long long to, long long add_to_index) const;
+        long long weight(long long from, long long to, long long weight_min, long long weight_max) const;
+
+        std::vector<Step> header_;
+        std::vector<Step> edge_;
+        EdgeWriter edge_writer_;
+        std::vector<std::string> texts_;
+        // bounds of the only {weight} of a layout with a specialized writer
+        long long weight_min_;
+        long long weight_max_;
+        bool has_weights_;
+        bool salted_;
+        unsigned long long salt_;
+    };
+
+    using OutputTemplatePtr = std::shared_ptr<const OutputTemplate>;
+}
+
+#ifdef GRAPH_CONSTRAINT_SOLVER_SINGLE_HEADER
+#include "output_template.cpp"
+#endif
+
+#endif //GRAPH_CONSTRAINT_SOLVER_OUTPUT_TEMPLATE_H
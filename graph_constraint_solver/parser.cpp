@@ -1,9 +1,13 @@
 #include "parser.h"
 
 #include <fstream>
+#include <map>
+#include <filesystem>
 
 #include "program_block.h"
 #include "constraint.h"
+#include "output_template.h"
+#include "utils.h"
 
 namespace graph_constraint_solver {
 
@@ -41,9 +45,22 @@ namespace graph_constraint_solver {
             {Token::kComponentType, "component-type"},
             {Token::kInputArguments, "arguments"},
             {Token::kOutputFormat, "format"},
+            {Token::kOutputFormatDebug, "debug"},
+            {Token::kOutputFormatShuffle, "shuffle"},
+            {Token::kOutputFormatSorted, "sorted"},
             {Token::kOutputGraphId, "graph-id"},
             {Token::kOutputFile, "file"},
             {Token::kOutputFileStdout, "stdout"},
+            {Token::kOutputFilePath, "path"},
+            {Token::kOutputFileShards, "shards"},
+            {Token::kOutputFileContainer, "container"},
+            {Token::kOutputRoot, "root"},
+            {Token::kOutputRootRandom, "random"},
+            {Token::kOutputSinks, "sinks"},
+            {Token::kOutputTemplate, "template"},
+            {Token::kOutputTemplateHeader, "header"},
+            {Token::kOutputTemplateEdge, "edge"},
+            {Token::kOutputManifest, "manifest"},
             {Token::kCreatorVertexReference, "vertex-id"},
             {Token::kCreatorEdgeReference, "edge-id"},
     };
@@ -63,6 +80,17 @@ namespace graph_constraint_solver {
             {"matrix", GraphPrinter::OutputFormat::Structure::kAdjMatrix},
 
             {"parent-array", GraphPrinter::OutputFormat::Structure::kParentArray},
+
+            {"binary-edge-list", GraphPrinter::OutputFormat::Structure::kBinaryEdgeList},
+            {"binary-list", GraphPrinter::OutputFormat::Structure::kBinaryEdgeList},
+            {"binary", GraphPrinter::OutputFormat::Structure::kBinaryEdgeList},
+
+            {"binary-csr", GraphPrinter::OutputFormat::Structure::kBinaryCSR},
+            {"csr", GraphPrinter::OutputFormat::Structure::kBinaryCSR},
+
+            {"binary-adjacency-matrix", GraphPrinter::OutputFormat::Structure::kBinaryAdjMatrix},
+            {"binary-matrix", GraphPrinter::OutputFormat::Structure::kBinaryAdjMatrix},
+            {"packed-matrix", GraphPrinter::OutputFormat::Structure::kBinaryAdjMatrix},
     };
 
     const std::unordered_map<Parser::String, GraphPrinter::OutputFormat::Indexation> Parser::name_to_output_format_indexation_ = {
@@ -79,6 +107,15 @@ namespace graph_constraint_solver {
             {"1", GraphPrinter::OutputFormat::Indexation::kOneBased},
     };
 
+    const std::unordered_map<Parser::String, GraphPrinter::OutputFormat::Compression> Parser::name_to_output_format_compression_ = {
+            {"gzip", GraphPrinter::OutputFormat::Compression::kGzip},
+            {"gz", GraphPrinter::OutputFormat::Compression::kGzip},
+    };
+
+    const std::unordered_map<Parser::String, GraphPrinter::OutputFormat::Compression> Parser::extension_to_output_format_compression_ = {
+            {".gz", GraphPrinter::OutputFormat::Compression::kGzip},
+    };
+
     const std::unordered_map<Parser::String, Constraint::Type> Parser::name_to_constraint_type_ = {
             {"graph-type", Constraint::Type::kGraphType},
             {"total-order", Constraint::Type::kOrder},
@@ -166,7 +203,9 @@ namespace graph_constraint_solver {
         return component_type;
     }
 
-    void Parser::parse(JSONFile &json_file, InputBlock::Arguments arguments) {
+    void Parser::parse(JSONFile &json_file, InputBlock::Arguments arguments, String program_file) {
+        program_file_ = program_file;
+        arguments_ = arguments;
         std::string text((std::istreambuf_iterator<char>(json_file)),
                 std::istreambuf_iterator<char>());
 
@@ -320,10 +359,35 @@ namespace graph_constraint_solver {
         auto format_token_name = token_to_name_.at(Token::kOutputFormat);
         auto structure = GraphPrinter::OutputFormat::kDefaultStructure;
         auto indexation = GraphPrinter::OutputFormat::kDefaultIndexation;
-        auto filepath = parse_output_filepath(object);
+        GraphPrinter::OutputFormat::Shards shards = 1;
+        bool container = false;
+        auto filepath = parse_output_filepath(object, shards, container);
+        bool debug = false;
+        bool shuffle = false;
+        bool sorted = false;
+        auto compression = GraphPrinter::OutputFormat::kDefaultCompression;
+        auto extension_position = filepath.rfind('.');
+        if (extension_position != Parser::String::npos &&
+                extension_to_output_format_compression_.count(filepath.substr(extension_position))) {
+            compression = extension_to_output_format_compression_.at(filepath.substr(extension_position));
+        }
+        // without zlib a compressed output would only fail once the graph is generated
+        auto check_compression = [&]() {
+#ifndef GRAPH_CONSTRAINT_SOLVER_ZLIB
+            if (compression != GraphPrinter::OutputFormat::Compression::kNone) {
+                throw_exception("compressed output requires a build with zlib");
+            }
+#endif
+        };
 
         if (!object.count(format_token_name)) {
-            return GraphPrinter::OutputFormat(structure, indexation, filepath);
+            check_compression();
+            auto root = parse_output_root(object, indexation);
+            auto layout = parse_output_template(object);
+            GraphPrinter::OutputFormat format(structure, indexation, filepath, debug, root, compression, shuffle, sorted,
+                    shards, layout, container);
+            format.manifest = parse_output_manifest(object);
+            return format;
         }
 
         nlohmann::json format_json_array = object.at(format_token_name);
@@ -351,11 +415,79 @@ namespace graph_constraint_solver {
                 ++indexation_options_cnt;
                 indexation = name_to_output_format_indexation_.at(option);
             }
+            else if (name_to_output_format_compression_.count(option)) {
+                compression = name_to_output_format_compression_.at(option);
+            }
+            else if (option == token_to_name_.at(Token::kOutputFormatDebug)) {
+                debug = true;
+            }
+            else if (option == token_to_name_.at(Token::kOutputFormatShuffle)) {
+                shuffle = true;
+            }
+            else if (option == token_to_name_.at(Token::kOutputFormatSorted)) {
+                sorted = true;
+            }
             else {
                 throw_exception("undefined output-format '" + option + "'");
             }
         }
-        return GraphPrinter::OutputFormat(structure, indexation, filepath);
+        check_compression();
+        if (shards > 1 && structure != GraphPrinter::OutputFormat::Structure::kEdgeList &&
+                structure != GraphPrinter::OutputFormat::Structure::kBinaryEdgeList) {
+            throw_exception("'" + token_to_name_.at(Token::kOutputFileShards) + "' can only be used with edge lists");
+        }
+        auto root = parse_output_root(object, indexation);
+        auto layout = parse_output_template(object);
+        if (layout && structure != GraphPrinter::OutputFormat::Structure::kEdgeList) {
+            throw_exception("'" + token_to_name_.at(Token::kOutputTemplate) + "' can only be used with text edge lists");
+        }
+        GraphPrinter::OutputFormat format(structure, indexation, filepath, debug, root, compression, shuffle, sorted,
+                shards, layout, container);
+        format.manifest = parse_output_manifest(object);
+        return format;
+    }
+
+    ManifestPtr Parser::parse_output_manifest(nlohmann::json object) {
+        auto manifest_token_name = token_to_name_.at(Token::kOutputManifest);
+        if (!object.count(manifest_token_name)) {
+            return nullptr;
+        }
+        nlohmann::json manifest_json = object.at(manifest_token_name);
+        if (!manifest_json.is_string() || manifest_json.get<Parser::String>().empty()) {
+            throw_exception("'" + manifest_token_name + "' expected file path");
+        }
+        return std::make_shared<Manifest>(manifest_json.get<Parser::String>(), program_file_, arguments_);
+    }
+
+    // {"header": "...", "edge": "..."}, a missing field keeps the default layout of that line
+    std::shared_ptr<const OutputTemplate> Parser::parse_output_template(nlohmann::json object) {
+        auto template_token_name = token_to_name_.at(Token::kOutputTemplate);
+        if (!object.count(template_token_name)) {
+            return nullptr;
+        }
+        nlohmann::json template_json = object.at(template_token_name);
+        auto header_token_name = token_to_name_.at(Token::kOutputTemplateHeader);
+        auto edge_token_name = token_to_name_.at(Token::kOutputTemplateEdge);
+        if (!template_json.is_object()) {
+            throw_exception("'" + template_token_name + "' expected object with '" + header_token_name + "' and '" +
+                    edge_token_name + "' strings");
+        }
+        auto header = OutputTemplate::kDefaultHeader;
+        auto edge = OutputTemplate::kDefaultEdge;
+        for (auto &[key, value] : template_json.items()) {
+            if ((key != header_token_name && key != edge_token_name) || !value.is_string()) {
+                throw_exception("'" + template_token_name + "' expected object with '" + header_token_name + "' and '" +
+                        edge_token_name + "' strings");
+            }
+            (key == header_token_name ? header : edge) = value.get<Parser::String>();
+        }
+        try {
+            return std::make_shared<OutputTemplate>(header, edge);
+        }
+        catch (std::invalid_argument &e) {
+            throw_exception(e.what());
+        }
+        return nullptr;
     }
 
     ProgramBlock::Identificator Parser::parse_output_graph_id(nlohmann::json object) {
@@ -374,23 +506,86 @@ namespace graph_constraint_solver {
         return id;
     }
 
-    GraphPrinter::OutputFormat::Filepath Parser::parse_output_filepath(nlohmann::json object) {
+    // 'file' is either a path (or 'stdout'), or an object {"path": ..., "shards": N} for sharded output
+    GraphPrinter::OutputFormat::Filepath Parser::parse_output_filepath(nlohmann::json object,
+            GraphPrinter::OutputFormat::Shards &shards, bool &container) {
+
         auto file_token_name = token_to_name_.at(Token::kOutputFile);
+        shards = 1;
+        container = false;
         if (!object.count(file_token_name)) {
             return GraphPrinter::OutputFormat::kDefaultFilepath;
         }
 
         nlohmann::json filepath_json = object.at(file_token_name);
-        if (!filepath_json.is_string()) {
+        if (filepath_json.is_object()) {
+            auto path_token_name = token_to_name_.at(Token::kOutputFilePath);
+            auto shards_token_name = token_to_name_.at(Token::kOutputFileShards);
+            if (!filepath_json.count(path_token_name) || !filepath_json.at(path_token_name).is_string()) {
+                throw_exception("'" + file_token_name + "' object expected '" + path_token_name + "' string field");
+            }
+            if (filepath_json.count(shards_token_name)) {
+                auto shards_json = filepath_json.at(shards_token_name);
+                if (!shards_json.is_number_integer() || shards_json.get<long long>() < 1 ||
+                        shards_json.get<long long>() > static_cast<long long>(GraphPrinter::OutputFormat::kMaximumShards)) {
+                    throw_exception("'" + shards_token_name + "' expected integer in range " +
+                    Utils::segment_to_string(1, GraphPrinter::OutputFormat::kMaximumShards));
+                }
+                shards = shards_json.get<GraphPrinter::OutputFormat::Shards>();
+            }
+            auto container_token_name = token_to_name_.at(Token::kOutputFileContainer);
+            if (filepath_json.count(container_token_name)) {
+                if (!filepath_json.at(container_token_name).is_boolean()) {
+                    throw_exception("'" + container_token_name + "' expected boolean");
+                }
+                container = filepath_json.at(container_token_name).get<bool>();
+            }
+            if (container && shards > 1) {
+                throw_exception("'" + container_token_name + "' and '" + shards_token_name + "' cannot be used together");
+            }
+            filepath_json = filepath_json.at(path_token_name);
+        }
+        else if (!filepath_json.is_string()) {
             throw_exception("expected file path or 'stdout'");
         }
         Parser::String filepath = filepath_json;
         if (filepath == token_to_name_.at(Token::kOutputFileStdout)) {
+            if (shards > 1) {
+                throw_exception("sharded output needs a file path");
+            }
+            if (container) {
+                throw_exception("container output needs a file path");
+            }
             return GraphPrinter::OutputFormat::kDefaultFilepath;
         }
         return filepath;
     }
 
+    GraphPrinter::OutputFormat::Root Parser::parse_output_root(nlohmann::json object,
+            GraphPrinter::OutputFormat::Indexation indexation) {
+
+        auto root_token_name = token_to_name_.at(Token::kOutputRoot);
+        if (!object.count(root_token_name)) {
+            return GraphPrinter::OutputFormat::kRandomRoot;
+        }
+
+        nlohmann::json root_json = object.at(root_token_name);
+        if (root_json.is_string() && root_json == token_to_name_.at(Token::kOutputRootRandom)) {
+            return GraphPrinter::OutputFormat::kRandomRoot;
+        }
+        if (!root_json.is_number_integer()) {
+            throw_exception("'" + root_token_name + "' expected vertex index or '" + token_to_name_.at(Token::kOutputRootRandom) + "'");
+        }
+        auto root = root_json.get<GraphPrinter::OutputFormat::Root>();
+        if (indexation == GraphPrinter::OutputFormat::Indexation::kOneBased) {
+            --root;
+        }
+        if (root < 0) {
+            throw_exception("'" + root_token_name + "' must be a valid vertex index");
+        }
+        return root;
+    }
+
     std::shared_ptr<OutputBlock> Parser::parse_output_block(nlohmann::json object) {
         if (object.count(token_to_name_.at(Token::kBlockType))) {
             auto block_type = parse_block_type(object);
@@ -400,10 +595,74 @@ namespace graph_constraint_solver {
         }
 
         auto graph_id = parse_output_graph_id(object);
+        if (object.count(token_to_name_.at(Token::kOutputSinks))) {
+            auto formats = parse_output_sinks(object);
+            return std::make_shared<OutputBlock>(current_block_id_, graph_id, formats, id_to_program_block_ptr_[graph_id]);
+        }
         auto format = parse_output_format(object);
         return std::make_shared<OutputBlock>(current_block_id_, graph_id, format, id_to_program_block_ptr_[graph_id]);
     }
 
+    // every sink is an object with its own 'format', 'file', 'root', 'template' and 'manifest' fields
+    std::vector<GraphPrinter::OutputFormat> Parser::parse_output_sinks(nlohmann::json object) {
+        auto sinks_token_name = token_to_name_.at(Token::kOutputSinks);
+        for (auto token : {Token::kOutputFormat, Token::kOutputFile, Token::kOutputRoot, Token::kOutputTemplate,
+                Token::kOutputManifest}) {
+            if (object.count(token_to_name_.at(token))) {
+                throw_exception("'" + token_to_name_.at(token) + "' cannot be used together with '" + sinks_token_name +
+                "', move it into the sinks");
+            }
+        }
+
+        nlohmann::json sinks_json = object.at(sinks_token_name);
+        if (!sinks_json.is_array() || sinks_json.empty()) {
+            throw_exception("'" + sinks_token_name + "' expected non-empty array of objects");
+        }
+        std::vector<GraphPrinter::OutputFormat> formats;
+        for (auto &sink_json : sinks_json) {
+            if (!sink_json.is_object()) {
+                throw_exception("'" + sinks_token_name + "' expected non-empty array of objects");
+            }
+            formats.push_back(parse_output_format(sink_json));
+        }
+
+        // sinks are printed concurrently, so no two of them may write the same file; containers lock their file
+        // and manifests only append whole lines, so those may be shared by sinks of the same kind
+        enum class Sharing { kExclusive, kContainer, kManifest };
+        std::map<Parser::String, Sharing> used_paths;
+        auto use_path = [&](const Parser::String &filepath, Sharing sharing) {
+            Parser::String resolved = filepath;
+            if (!filepath.empty()) {
+                std::error_code error;
+                auto canonical = std::filesystem::weakly_canonical(std::filesystem::absolute(filepath, error), error);
+                resolved = error ? std::filesystem::path(filepath).lexically_normal().string() : canonical.string();
+            }
+            auto [used, inserted] = used_paths.emplace(resolved, sharing);
+            if (!inserted && (sharing == Sharing::kExclusive || used->second != sharing)) {
+                throw_exception("'" + sinks_token_name + "' cannot write " +
+                (filepath.empty() ? "the standard output" : "'" + filepath + "'") + " more than once");
+            }
+        };
+        for (auto &format : formats) {
+            if (format.container) {
+                use_path(format.filepath, Sharing::kContainer);
+            }
+            else if (format.shards > 1) {
+                for (size_t shard = 0; shard < format.shards; ++shard) {
+                    use_path(GraphPrinter::shard_filepath(format.filepath, shard, format.shards), Sharing::kExclusive);
+                }
+                use_path(format.filepath + GraphPrinter::kManifestExtension, Sharing::kExclusive);
+            }
+            else {
+                use_path(format.filepath, Sharing::kExclusive);
+            }
+            if (format.manifest) {
+                use_path(format.manifest->filepath(), Sharing::kManifest);
+            }
+        }
+        return formats;
+    }
+
     std::shared_ptr<CreatorBlock> Parser::parse_creator_block(nlohmann::json object) {
         auto component_type = parse_component_type(object);
         auto vertex_reference_constraint_block_ptr = parse_vertex_reference(object);
@@ -17,7 +17,8 @@ namespace graph_constraint_solver {
     public:
         using JSONFile = std::ifstream;
         using String = std::string;
-        void parse(JSONFile &json_file, InputBlock::Arguments arguments);
+        // 'program_file' and the arguments are only recorded in output manifests
+        void parse(JSONFile &json_file, InputBlock::Arguments arguments, String program_file = "");
 
         std::vector<std::shared_ptr<OutputBlock>> get_output_blocks();
 
@@ -42,9 +43,16 @@ namespace graph_constraint_solver {
 
         static const std::unordered_map<String, GraphPrinter::OutputFormat::Structure> name_to_output_format_structure_;
         static const std::unordered_map<String, GraphPrinter::OutputFormat::Indexation> name_to_output_format_indexation_;
+        static const std::unordered_map<String, GraphPrinter::OutputFormat::Compression> name_to_output_format_compression_;
+        static const std::unordered_map<String, GraphPrinter::OutputFormat::Compression> extension_to_output_format_compression_;
         GraphPrinter::OutputFormat parse_output_format(nlohmann::json object);
         ProgramBlock::Identificator parse_output_graph_id(nlohmann::json object);
-        GraphPrinter::OutputFormat::Filepath parse_output_filepath(nlohmann::json object);
+        GraphPrinter::OutputFormat::Filepath parse_output_filepath(nlohmann::json object,
+                GraphPrinter::OutputFormat::Shards &shards, bool &container);
+        std::vector<GraphPrinter::OutputFormat> parse_output_sinks(nlohmann::json object);
+        std::shared_ptr<const OutputTemplate> parse_output_template(nlohmann::json object);
+        ManifestPtr parse_output_manifest(nlohmann::json object);
+        GraphPrinter::OutputFormat::Root parse_output_root(nlohmann::json object, GraphPrinter::OutputFormat::Indexation indexation);
         std::shared_ptr<OutputBlock> parse_output_block(nlohmann::json object);
 
         static const std::unordered_map<Parser::String, Constraint::Type> name_to_constraint_type_;
@@ -59,6 +67,8 @@ namespace graph_constraint_solver {
         std::shared_ptr<CreatorBlock> parse_creator_block(nlohmann::json object);
 
         ProgramBlock::Identificator current_block_id_;
+        String program_file_;
+        InputBlock::Arguments arguments_;
         std::vector<std::shared_ptr<OutputBlock>> output_blocks_;
 
         enum class Token {
@@ -66,9 +76,22 @@ namespace graph_constraint_solver {
             kComponentType,
             kInputArguments,
             kOutputFormat,
+            kOutputFormatDebug,
+            kOutputFormatShuffle,
+            kOutputFormatSorted,
             kOutputGraphId,
             kOutputFile,
             kOutputFileStdout,
+            kOutputFilePath,
+            kOutputFileShards,
+            kOutputFileContainer,
+            kOutputRoot,
+            kOutputRootRandom,
+            kOutputSinks,
+            kOutputTemplate,
+            kOutputTemplateHeader,
+            kOutputTemplateEdge,
+            kOutputManifest,
             kCreatorVertexReference,
             kCreatorEdgeReference,
         };
@@ -7,7 +7,7 @@
 namespace graph_constraint_solver {
     class Program {
     public:
-        Program(Parser::JSONFile &json_file, InputBlock::Arguments arguments);
+        Program(Parser::JSONFile &json_file, InputBlock::Arguments arguments, Parser::String program_file = "");
     };
 }
 
@@ -12,6 +12,10 @@ namespace graph_constraint_solver {
         return type_;
     }
 
+    bool ProgramBlock::print_graph_streaming(GraphPrinter::OutputFormat &) {
+        return false;
+    }
+
     InputBlock::InputBlock(Identificator id, Arguments arguments)
         : ProgramBlock(Type::kInput, id), arguments_(arguments) {
 
@@ -26,17 +30,37 @@ namespace graph_constraint_solver {
     }
 
     void OutputBlock::print_graph(bool debug) {
+        if (formats_.size() > 1) {
+            auto graph = generate_graph();
+            graph->print(formats_, debug);
+            return;
+        }
+
+        auto &format = formats_.front();
+        debug = debug || format.debug;
+        if (!debug && graph_program_block_ptr_->print_graph_streaming(format)) {
+            return;
+        }
         auto graph = generate_graph();
-        graph->print(format_, debug);
+        graph->print(format, debug);
     }
 
     OutputBlock::OutputBlock(Identificator id, Identificator graph_id, GraphPrinter::OutputFormat format,
             ProgramBlockPtr graph_program_block_ptr)
-        : ProgramBlock(Type::kOutput, id), graph_id_(graph_id), format_(format),
-        graph_program_block_ptr_(graph_program_block_ptr)  {
+        : OutputBlock(id, graph_id, std::vector<GraphPrinter::OutputFormat>{format}, graph_program_block_ptr) {
 
     }
 
+    OutputBlock::OutputBlock(Identificator id, Identificator graph_id, std::vector<GraphPrinter::OutputFormat> formats,
+            ProgramBlockPtr graph_program_block_ptr)
+        : ProgramBlock(Type::kOutput, id), graph_id_(graph_id), graph_program_block_ptr_(graph_program_block_ptr),
+        formats_(std::move(formats)) {
+
+        if (formats_.empty()) {
+            throw std::invalid_argument("OutputBlock error: at least one output format is required");
+        }
+    }
+
 
     CreatorBlock::CreatorBlock(Identificator id, ConstraintBlockPtr constraint_block_ptr)
         : ProgramBlock(Type::kCreator, id), constraint_block_ptr_(constraint_block_ptr) {
@@ -48,9 +72,24 @@ namespace graph_constraint_solver {
     }
 
     GraphComponentsPtr CreatorBlock::generate_graph() {
+        auto stream = random.stream(Random::stream_id(id_, generations_++));
         Generator generator;
         auto graph = generator.generate(constraint_block_ptr_);
         return graph;
     }
 
+    bool CreatorBlock::print_graph_streaming(GraphPrinter::OutputFormat &format) {
+        Generator generator;
+        // streamed edges come out in generation order, sorted output needs the whole graph
+        if (format.structure != GraphPrinter::OutputFormat::Structure::kEdgeList || format.sorted || format.shards > 1 ||
+                !generator.supports_streaming(constraint_block_ptr_)) {
+            return false;
+        }
+        GraphPrinter printer(format);
+        auto stream = random.stream(Random::stream_id(id_, generations_++));
+        generator.generate_to_sink(constraint_block_ptr_, printer.edge_list_sink());
+        printer.close();
+        return true;
+    }
+
 }
\ No newline at end of file
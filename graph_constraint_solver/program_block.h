@@ -25,6 +25,8 @@ namespace graph_constraint_solver {
         Type type();
 
         virtual GraphComponentsPtr generate_graph() = 0;
+        // prints the graph without materializing it when the block allows it, returns false otherwise
+        virtual bool print_graph_streaming(GraphPrinter::OutputFormat &format);
 
     protected:
         Type type_;
@@ -48,13 +50,16 @@ namespace graph_constraint_solver {
     class OutputBlock : public ProgramBlock {
     public:
         OutputBlock(Identificator id, Identificator graph_id, GraphPrinter::OutputFormat format, ProgramBlockPtr graph_program_block_ptr);
+        // one generated graph is printed into every format (fan-out)
+        OutputBlock(Identificator id, Identificator graph_id, std::vector<GraphPrinter::OutputFormat> formats,
+                ProgramBlockPtr graph_program_block_ptr);
         GraphComponentsPtr generate_graph() override;
         void print_graph(bool debug = false);
 
     private:
         Identificator graph_id_;
         ProgramBlockPtr graph_program_block_ptr_;
-        GraphPrinter::OutputFormat format_;
+        std::vector<GraphPrinter::OutputFormat> formats_;
     };
 
     class CreatorBlock : public ProgramBlock {
@@ -62,9 +67,12 @@ namespace graph_constraint_solver {
         CreatorBlock(Identificator id, ConstraintBlockPtr constraint_block_ptr);
         ConstraintBlockPtr get_constraint_block_ptr();
         GraphComponentsPtr generate_graph() override;
+        bool print_graph_streaming(GraphPrinter::OutputFormat &format) override;
 
     private:
         ConstraintBlockPtr constraint_block_ptr_;
+        // the n-th generation of the block draws from the stream (id, n), independent of the other blocks
+        unsigned long long generations_ = 0;
     };
 
     class OrientatorBlock : public ProgramBlock {
@@ -1,22 +1,247 @@
 #include "utils.h"
 
+#include <atomic>
+#include <algorithm>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <thread>
+
 namespace graph_constraint_solver {
     Random random = Random();
 
-    std::mt19937_64 Random::rng() {
-        return rng_;
+    namespace impl {
+        unsigned long long mix(unsigned long long value) {
+            value += 0x9e3779b97f4a7c15ULL;
+            value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            value = (value ^ (value >> 27)) * 0x94d049bb133111ebULL;
+            return value ^ (value >> 31);
+        }
+
+        // 'lanes' consecutive Philox4x32-10 blocks starting at 'counter', two numbers per block
+        // the rounds of a block are a straight line of code after unrolling and the blocks are independent,
+        // so the loop over them vectorizes where the target has 32x32->64 vector multiplications (e.g. AVX2)
+        template<size_t lanes>
+        void philox_blocks(unsigned long long key, unsigned long long stream, unsigned long long counter,
+                unsigned long long *out) {
+            const uint32_t kMultiplier0 = 0xD2511F53;
+            const uint32_t kMultiplier1 = 0xCD9E8D57;
+            const uint32_t kWeyl0 = 0x9E3779B9;
+            const uint32_t kWeyl1 = 0xBB67AE85;
+
+            for (size_t lane = 0; lane < lanes; ++lane) {
+                uint32_t word0 = static_cast<uint32_t>(counter + lane);
+                uint32_t word1 = static_cast<uint32_t>((counter + lane) >> 32);
+                uint32_t word2 = static_cast<uint32_t>(stream);
+                uint32_t word3 = static_cast<uint32_t>(stream >> 32);
+                uint32_t key0 = static_cast<uint32_t>(key);
+                uint32_t key1 = static_cast<uint32_t>(key >> 32);
+                for (int round = 0; round < 10; ++round) {
+                    auto product0 = static_cast<uint64_t>(kMultiplier0) * word0;
+                    auto product1 = static_cast<uint64_t>(kMultiplier1) * word2;
+                    word0 = static_cast<uint32_t>(product1 >> 32) ^ word1 ^ key0;
+                    word1 = static_cast<uint32_t>(product1);
+                    word2 = static_cast<uint32_t>(product0 >> 32) ^ word3 ^ key1;
+                    word3 = static_cast<uint32_t>(product0);
+                    key0 += kWeyl0;
+                    key1 += kWeyl1;
+                }
+                out[2 * lane] = static_cast<unsigned long long>(word1) << 32 | word0;
+                out[2 * lane + 1] = static_cast<unsigned long long>(word3) << 32 | word2;
+            }
+        }
+    }
+
+    Philox::Philox(unsigned long long key, unsigned long long stream)
+        : key_(key), stream_(stream), counter_(0), block_{0, 0}, used_(2) {
+
+    }
+
+    Philox::result_type Philox::operator()() {
+        if (used_ == 2) {
+            generate_block();
+            used_ = 0;
+        }
+        return block_[used_++];
+    }
+
+    void Philox::fill(result_type *out, size_t count) {
+        // leftovers of the current block first, so the values don't depend on how they are requested
+        for (; count && used_ < 2; --count) {
+            *out++ = block_[used_++];
+        }
+        for (; count >= 2 * kLanes; count -= 2 * kLanes, out += 2 * kLanes) {
+            impl::philox_blocks<kLanes>(key_, stream_, counter_, out);
+            counter_ += kLanes;
+        }
+        for (; count; --count) {
+            *out++ = (*this)();
+        }
+    }
+
+    unsigned long long Philox::stream() const {
+        return stream_;
+    }
+
+    void Philox::generate_block() {
+        impl::philox_blocks<1>(key_, stream_, counter_, block_);
+        ++counter_;
+    }
+
+    Xoshiro::Xoshiro(unsigned long long key, unsigned long long stream) : stream_(stream) {
+        auto seed = impl::mix(key) ^ stream;
+        for (auto &word : state_) {
+            seed += 0x9e3779b97f4a7c15ULL;
+            word = impl::mix(seed);
+        }
+    }
+
+    Xoshiro::result_type Xoshiro::operator()() {
+        auto rotate_left = [](unsigned long long value, int bits) {
+            return (value << bits) | (value >> (64 - bits));
+        };
+        auto result = rotate_left(state_[1] * 5, 7) * 9;
+        auto t = state_[1] << 17;
+        state_[2] ^= state_[0];
+        state_[3] ^= state_[1];
+        state_[1] ^= state_[2];
+        state_[0] ^= state_[3];
+        state_[2] ^= t;
+        state_[3] = rotate_left(state_[3], 45);
+        return result;
+    }
+
+    void Xoshiro::fill(result_type *out, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            out[i] = (*this)();
+        }
+    }
+
+    unsigned long long Xoshiro::stream() const {
+        return stream_;
+    }
+
+    thread_local Random::State *Random::current_ = nullptr;
+
+    Random::Stream::Stream(State *state, Engine engine) : previous_(current_) {
+        if (!state) {
+            owned_ = std::make_unique<State>(State{engine, 0});
+            state = owned_.get();
+        }
+        current_ = state;
+    }
+
+    Random::Stream::~Stream() {
+        current_ = previous_;
+    }
+
+    Random::Stream Random::stream(StreamId id) {
+        return Stream(nullptr, Engine(seed_, id));
+    }
+
+    Random::Stream Random::root_stream() {
+        return Stream(&root_, Engine());
+    }
+
+    Random::StreamId Random::split() {
+        auto &state = current();
+        return impl::mix(state.engine.stream() ^ impl::mix(++state.splits));
+    }
+
+    Random::StreamId Random::stream_id(const std::string &name, unsigned long long index) {
+        // FNV-1a of the name
+        unsigned long long hash = 0xcbf29ce484222325ULL;
+        for (auto c : name) {
+            hash = (hash ^ static_cast<unsigned char>(c)) * 0x100000001b3ULL;
+        }
+        return impl::mix(impl::mix(hash) ^ index);
+    }
+
+    Random::State& Random::current() {
+        return current_ ? *current_ : root_;
+    }
+
+    Random::Engine& Random::engine() {
+        return current().engine;
+    }
+
+    Random::Engine& Random::rng() {
+        return engine();
+    }
+
+    Random::Batch::Batch(Random &random) : random_(random), used_(kSize) {
+
+    }
+
+    unsigned long long Random::Batch::bits() {
+        if (used_ == kSize) {
+            random_.fill(values_, kSize);
+            used_ = 0;
+        }
+        return values_[used_++];
+    }
+
+    double Random::Batch::next() {
+        return static_cast<double>(bits() >> 11) * 0x1.0p-53;
+    }
+
+    long long Random::Batch::next(long long n) {
+        if (n <= 0) {
+            return 0;
+        }
+        return next(0, n - 1);
+    }
+
+    long long Random::Batch::next(long long l, long long r) {
+        auto range = static_cast<unsigned long long>(r) - static_cast<unsigned long long>(l) + 1;
+        auto value = bits();
+        if (range != 0) {
+            // Lemire's mapping as in Random::bounded, rejected values are replaced from the batch
+            auto product = static_cast<unsigned __int128>(value) * range;
+            if (static_cast<unsigned long long>(product) < range) {
+                auto threshold = (0ULL - range) % range;
+                while (static_cast<unsigned long long>(product) < threshold) {
+                    product = static_cast<unsigned __int128>(bits()) * range;
+                }
+            }
+            value = static_cast<unsigned long long>(product >> 64);
+        }
+        return static_cast<long long>(static_cast<unsigned long long>(l) + value);
+    }
+
+    unsigned long long Random::bounded(unsigned long long range) {
+        auto &rng = engine();
+        if (range == 0) {
+            return rng();
+        }
+        auto product = static_cast<unsigned __int128>(rng()) * range;
+        auto low = static_cast<unsigned long long>(product);
+        if (low < range) {
+            auto threshold = (0ULL - range) % range;
+            while (low < threshold) {
+                product = static_cast<unsigned __int128>(rng()) * range;
+                low = static_cast<unsigned long long>(product);
+            }
+        }
+        return static_cast<unsigned long long>(product >> 64);
     }
 
     void Random::set_seed(long long seed) {
-        rng_.seed(seed);
+        seed_ = seed;
+        root_ = State{Engine(seed, 0), 0};
+    }
+
+    long long Random::seed() {
+        return seed_;
     }
 
     double Random::next() {
-        return std::uniform_real_distribution<double>(0, 1)(rng_);
+        // 53 random bits, uniform in [0, 1)
+        return static_cast<double>(engine()() >> 11) * 0x1.0p-53;
     }
 
     size_t Random::next(size_t n) {
-        return std::uniform_int_distribution<size_t>(0, n - 1)(rng_);
+        return bounded(n);
     }
 
     int Random::next(int n) {
@@ -34,11 +259,12 @@ namespace graph_constraint_solver {
     }
 
     int Random::next(int l, int r) {
-        return std::uniform_int_distribution<int>(l, r)(rng_);
+        return static_cast<int>(next(static_cast<long long>(l), static_cast<long long>(r)));
     }
 
     long long Random::next(long long l, long long r) {
-        return std::uniform_int_distribution<long long>(l, r)(rng_);
+        auto range = static_cast<unsigned long long>(r) - static_cast<unsigned long long>(l) + 1;
+        return static_cast<long long>(static_cast<unsigned long long>(l) + bounded(range));
     }
 
     int Random::next(std::pair<int, int> bounds) {
@@ -49,6 +275,38 @@ namespace graph_constraint_solver {
         return next(bounds.first, bounds.second);
     }
 
+    void Random::fill(unsigned long long *out, size_t count) {
+        engine().fill(out, count);
+    }
+
+    void Random::fill(double *out, size_t count) {
+        unsigned long long values[Batch::kSize];
+        auto &rng = engine();
+        for (size_t done = 0; done < count; done += Batch::kSize) {
+            auto part = std::min(count - done, Batch::kSize);
+            rng.fill(values, part);
+            for (size_t i = 0; i < part; ++i) {
+                out[done + i] = static_cast<double>(values[i] >> 11) * 0x1.0p-53;
+            }
+        }
+    }
+
+    void Random::fill(unsigned long long *out, size_t count, unsigned long long range) {
+        auto &rng = engine();
+        rng.fill(out, count);
+        if (range == 0) {
+            return;
+        }
+        auto threshold = (0ULL - range) % range;
+        for (size_t i = 0; i < count; ++i) {
+            auto product = static_cast<unsigned __int128>(out[i]) * range;
+            while (static_cast<unsigned long long>(product) < threshold) {
+                product = static_cast<unsigned __int128>(rng()) * range;
+            }
+            out[i] = static_cast<unsigned long long>(product >> 64);
+        }
+    }
+
     int Random::wnext(int n, int weight) {
         if (weight == 0) {
             return next(n);
@@ -136,6 +394,57 @@ namespace graph_constraint_solver {
         return "[" + std::to_string(left_bound) + ", " + std::to_string(right_bound) + "]";
     }
 
+    size_t Utils::hardware_threads() {
+        return std::max<size_t>(1, std::thread::hardware_concurrency());
+    }
+
+    namespace impl {
+        thread_local bool inside_parallel_for = false;
+    }
+
+    void Utils::parallel_for(size_t tasks, std::function<void(size_t)> f) {
+        auto threads_number = std::min(tasks, hardware_threads());
+        if (threads_number <= 1 || impl::inside_parallel_for) {
+            for (size_t i = 0; i < tasks; ++i) {
+                f(i);
+            }
+            return;
+        }
+
+        std::atomic<size_t> next_task(0);
+        std::exception_ptr exception;
+        std::mutex exception_mutex;
+
+        auto worker = [&]() {
+            impl::inside_parallel_for = true;
+            for (auto i = next_task++; i < tasks; i = next_task++) {
+                try {
+                    f(i);
+                }
+                catch (...) {
+                    std::lock_guard<std::mutex> lock(exception_mutex);
+                    if (!exception) {
+                        exception = std::current_exception();
+                    }
+                    next_task = tasks;
+                }
+            }
+            impl::inside_parallel_for = false;
+        };
+
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i + 1 < threads_number; ++i) {
+            threads.emplace_back(worker);
+        }
+        worker();
+        for (auto &thread : threads) {
+            thread.join();
+        }
+        if (exception) {
+            std::rethrow_exception(exception);
+        }
+    }
+
     DSU::DSU(int n, bool only_consecutive_unions) :
         n_(n), only_consecutive_unions_(only_consecutive_unions),
         parent_(n), size_(n), left_(n), right_(n) {
@@ -1,18 +1,136 @@
 #ifndef GRAPH_CONSTRAINT_SOLVER_UTILS_H
 #define GRAPH_CONSTRAINT_SOLVER_UTILS_H
 
+#include <algorithm>
 #include <memory>
 #include <functional>
 #include <random>
 #include <chrono>
+#include <vector>
+#include <string>
 
 namespace graph_constraint_solver {
 
+    namespace impl {
+        // splitmix64 finalizer
+        unsigned long long mix(unsigned long long value);
+    }
+
+    // Philox4x32-10 counter-based engine (Salmon et al., "Parallel random numbers: as easy as 1, 2, 3"):
+    // the n-th number of a stream is a function of (key, stream, n) only, so any number of independent
+    // streams can be created without shared state, every block of rounds gives two 64-bit numbers
+    class Philox {
+    public:
+        using result_type = unsigned long long;
+        static constexpr result_type min() { return 0; }
+        static constexpr result_type max() { return ~0ULL; }
+
+        // blocks computed together by fill(), independent lanes the compiler can map to SIMD registers
+        static constexpr size_t kLanes = 8;
+
+        explicit Philox(unsigned long long key = 0, unsigned long long stream = 0);
+        result_type operator()();
+        // the same values as 'count' calls of operator(), whole runs of blocks are computed lane by lane
+        void fill(result_type *out, size_t count);
+        unsigned long long stream() const;
+
+    private:
+        void generate_block();
+
+        unsigned long long key_;
+        unsigned long long stream_;
+        unsigned long long counter_;
+        unsigned long long block_[2];
+        size_t used_;
+    };
+
+    // xoshiro256** (Blackman, Vigna), seeded from (key, stream) with splitmix64: faster than Philox,
+    // streams are independent by hashing instead of by construction
+    class Xoshiro {
+    public:
+        using result_type = unsigned long long;
+        static constexpr result_type min() { return 0; }
+        static constexpr result_type max() { return ~0ULL; }
+
+        explicit Xoshiro(unsigned long long key = 0, unsigned long long stream = 0);
+        result_type operator()();
+        // the same values as 'count' calls of operator()
+        void fill(result_type *out, size_t count);
+        unsigned long long stream() const;
+
+    private:
+        unsigned long long stream_;
+        unsigned long long state_[4];
+    };
+
     // TODO: may be just use testlib.h for random stuff
     class Random {
+    private:
+        struct State;
+
     public:
-        std::mt19937_64 rng();
+        // the engine is chosen at build time, GRAPH_CONSTRAINT_SOLVER_XOSHIRO selects xoshiro256**
+        // outputs for a seed differ between engines
+#ifdef GRAPH_CONSTRAINT_SOLVER_XOSHIRO
+        using Engine = Xoshiro;
+#else
+        using Engine = Philox;
+#endif
+        // streams are identified by their path from the root stream of the seed: a stream's children get
+        // ids derived from its own id and their ordinal, so a stream depends on the seed and its path only
+        using StreamId = unsigned long long;
+
+        // while a Stream is alive, draws made by its thread come from it, so tasks running in parallel
+        // don't race on the root stream and the output doesn't depend on the number of threads
+        class Stream {
+        public:
+            ~Stream();
+            Stream(const Stream&) = delete;
+            Stream& operator=(const Stream&) = delete;
+
+        private:
+            friend class Random;
+            // the root stream is not owned, it's shared by all threads
+            Stream(State *state, Engine engine);
+
+            std::unique_ptr<State> owned_;
+            State *previous_;
+        };
+
+        // draws made ahead in chunks for hot loops, values come from the stream that is current when
+        // a chunk is refilled, so a Batch must not outlive the stream it is created in
+        // unused values of the last chunk are dropped, the stream is advanced by whole chunks
+        class Batch {
+        public:
+            static constexpr size_t kSize = 256;
+
+            explicit Batch(Random &random);
+            // the same distributions as Random::next
+            double next();
+            long long next(long long n);
+            long long next(long long l, long long r);
+
+        private:
+            unsigned long long bits();
+
+            Random &random_;
+            unsigned long long values_[kSize];
+            size_t used_;
+        };
+
+        Stream stream(StreamId id);
+        // draws go to the root stream again, for decisions that must not depend on where they are made
+        Stream root_stream();
+        // id of a new child of the current stream
+        StreamId split();
+        // id of a child of the root stream named by a program block and the number of its generation
+        static StreamId stream_id(const std::string &name, unsigned long long index);
+
+        // the current stream's engine itself, drawing from it (e.g. with std::shuffle) advances the stream
+        Engine& rng();
         void set_seed(long long seed);
+        // the last seed given to set_seed, 0 if it was never called
+        long long seed();
 
         double next();
         size_t next(size_t n);
@@ -25,8 +143,36 @@ namespace graph_constraint_solver {
         long long next(std::pair<long long, long long> bounds);
         // function from testlib
         int wnext(int n, int weight);
+
+        // batch versions of next(): raw 64-bit values, doubles in [0, 1), integers in [0, range)
+        // (the whole 64-bit range for 0)
+        void fill(unsigned long long *out, size_t count);
+        void fill(double *out, size_t count);
+        void fill(unsigned long long *out, size_t count, unsigned long long range);
+
+        // Fisher-Yates with batched draws
+        template<typename RandomIt>
+        void shuffle(RandomIt first, RandomIt last) {
+            Batch batch(*this);
+            for (auto i = last - first - 1; i > 0; --i) {
+                std::iter_swap(first + i, first + batch.next(i + 1));
+            }
+        }
     private:
-        std::mt19937_64 rng_;
+        struct State {
+            Engine engine;
+            unsigned long long splits;
+        };
+
+        State& current();
+        Engine& engine();
+        // uniform in [0, range), the whole 64-bit range for 0, Lemire's multiply-shift rejection
+        // ("Fast random integer generation in an interval"), a division only on the rare rejection path
+        unsigned long long bounded(unsigned long long range);
+
+        State root_ = State{Engine(), 0};
+        long long seed_ = 0;
+        static thread_local State *current_;
     };
 
     extern Random random;
@@ -55,6 +201,11 @@ namespace graph_constraint_solver {
                 std::string exception_prefix);
 
         static std::string segment_to_string(ll left_bound, ll right_bound);
+
+        static size_t hardware_threads();
+        // calls f(0), ..., f(tasks - 1) on up to hardware_threads() threads
+        // nested calls (from inside f) run sequentially in the calling thread
+        static void parallel_for(size_t tasks, std::function<void(size_t)> f);
     };
 
     // TODO: maybe use boost ???